@@ -1,6 +1,12 @@
-#include "demo.h"
+#include "demoreader.h"
+#include "commandtracker.h"
 #include <iostream>
 #include <fstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <filesystem>
 
 using namespace DemoJKA;
 using namespace std;
@@ -25,26 +31,20 @@ static const char* htmlcolors[] =
     "\"#FFFFFF\"", //7
 };
 
+//no shared buffer, corpus mode sanitizes from several threads
 string sanitize(const string& command, int mod) {
-    //dest <= souce always (we only remove from source, never add)
-    static char buffer[2048];
-    int sourceId = 0;
-    char* dest = buffer;
+    string result;
+    result.reserve(command.size());
 
-    for (; command[sourceId] != 0; ++sourceId)
+    for (int sourceId = 0; command[sourceId] != 0; ++sourceId)
     {
         if ((command[sourceId] == '^' && (command[sourceId + 1] >= '0') && (command[sourceId + 1] <= '7')) &&
             (mod == MOD_HTML || mod == MOD_RAW_TEXT)) {
 
             if (mod == MOD_HTML) {
-                strcpy_s(dest, 40, "</font><font color=");
-                dest += strlen("</font><font color=");
-
-                strcpy_s(dest, 20, htmlcolors[command[sourceId + 1] - '0']);
-                dest += strlen(htmlcolors[command[sourceId + 1] - '0']);
-
-                *dest = '>';
-                ++dest;
+                result += "</font><font color=";
+                result += htmlcolors[command[sourceId + 1] - '0'];
+                result += '>';
             }
 
             //need to increment here, two increments must be done
@@ -55,29 +55,42 @@ string sanitize(const string& command, int mod) {
             continue;
         }
         else {
-            *dest = command[sourceId];
-            ++dest;
+            result += command[sourceId];
         }
     }
-    *dest = 0;
 
-    return string(buffer);
+    return result;
 }
 
-void logCommand(const string& command, int mod) {
+/*
+Gives text of chat command (with color codes), false for other commands.
+team is set for team chat.
+*/
+bool getChatLine(const string& command, string& chatLine, bool* team) {
     const char* str = command.c_str();
-    string chatLine;
 
     if (!strncmp(str, "chat", 4)) {
         chatLine = command.substr(5);
+        *team = false;
     }
     else if (!strncmp(str, "tchat", 5)) {
         chatLine = command.substr(6);
+        *team = true;
     }
     else {
-        return;
+        return false;
     }
 
+    return true;
+}
+
+void logCommand(const string& command, int mod) {
+    string chatLine;
+    bool team;
+
+    if (!getChatLine(command, chatLine, &team))
+        return;
+
     chatLine = sanitize(chatLine, mod);
 
     if (mod == MOD_HTML) {
@@ -93,8 +106,318 @@ void logCommand(const string& command, int mod) {
     outputFile << endl;
 }
 
+/*
+Corpus mode, chat of many demos goes to one JSON Lines file, one record per
+chat line:
+
+    {"demo":"...","map":"...","time":123456,"team":false,"text":"...","raw":"..."}
+
+time is server time of the snapshot the command came with, text is sanitized
+and raw keeps color codes. Demos are taken from directory (all .dm_* files,
+recursively) or from manifest (one path per line, # for comments).
+
+Workers take demos one by one from shared counter. Records of every demo are
+buffered and written in order of input, so demos are taken in that order too
+and only demos being extracted wait in memory. When order isnt needed, each
+worker writes its own shard file (output.N.jsonl) and largest demos go first,
+so no worker is left with a big one at the end. Demo which fails gives no
+records.
+*/
+struct CorpusDemo {
+    string      path;
+    long long   size;
+
+    //result
+    bool    done;
+    bool    ok;
+    int     lines;
+    string  records;
+    string  error;
+};
+
+static vector<CorpusDemo>   corpus;
+static vector<int>          corpusOrder;    //largest first when sharded
+static atomic<int>          nextDemo(0);
+static mutex                writeMutex;
+static ofstream             corpusOutput;
+static int                  nextWritten = 0;
+static bool                 sharded = false;
+static string               outputName;
+
+static void appendJsonString(string& out, const string& s) {
+    static const char hex[] = "0123456789abcdef";
+
+    out += '"';
+    for (int i = 0; i < (int)s.size(); ++i) {
+        unsigned char c = (unsigned char)s[i];
+
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        }
+        else if (c < 0x20 || c >= 0x7f) {
+            //game strings arent utf-8, other bytes are latin-1 code points
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+        else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+static string getMapName(Gamestate* gamestate) {
+    string info = gamestate->getConfigstring(0); //serverinfo
+    size_t start = info.find("\\mapname\\");
+
+    if (start == string::npos)
+        return string();
+
+    start += 9;
+    return info.substr(start, info.find('\\', start) - start);
+}
+
+static void extractDemo(CorpusDemo& demo) {
+    DemoReader reader;
+
+    if (!reader.open(demo.path.c_str())) {
+        demo.error = "demo could not be opened";
+        return;
+    }
+
+    //snapshot header is needed for server time, rest of it isnt decoded
+    reader.setDecodeDepth(DECODE_HEADER);
+
+    CommandTracker commandTracker;
+    string mapName;
+    int serverTime = 0;
+
+    try {
+        while (reader.next()) {
+            Message* message = reader.getMessage();
+            commandTracker.removeDuplicates(message);
+
+            for (int i = 0; i < message->getInstructionsCount(); ++i) {
+                Instruction* instruction = message->getInstruction(i);
+
+                if (instruction->getType() == INSTR_GAMESTATE)
+                    mapName = getMapName(instruction->getGamestate());
+                else if (instruction->getType() == INSTR_SNAPSHOT)
+                    serverTime = instruction->getSnapshot()->getServertime();
+            }
+
+            for (int i = 0; i < message->getInstructionsCount(); ++i) {
+                ServerCommand* serverCommand = message->getInstruction(i)->getServerCommand();
+                string chatLine;
+                bool team;
+
+                if (!serverCommand || !getChatLine(serverCommand->getCommand(), chatLine, &team))
+                    continue;
+
+                string& out = demo.records;
+                out += "{\"demo\":";
+                appendJsonString(out, demo.path);
+                out += ",\"map\":";
+                appendJsonString(out, mapName);
+                out += ",\"time\":" + to_string(serverTime);
+                out += team ? ",\"team\":true" : ",\"team\":false";
+                out += ",\"text\":";
+                appendJsonString(out, sanitize(chatLine, MOD_RAW_TEXT));
+                out += ",\"raw\":";
+                appendJsonString(out, sanitize(chatLine, MOD_COLORED_TEXT));
+                out += "}\n";
+                ++demo.lines;
+            }
+        }
+
+        if (reader.isCorrupted())
+            throw DemoException("demo is corrupted");
+
+        demo.ok = true;
+    }
+    catch (exception& e) {
+        //records of the demo would be incomplete
+        string().swap(demo.records);
+        demo.lines = 0;
+        demo.error = e.what();
+    }
+}
+
+//writes every finished demo whose predecessors are written already
+static void writeInOrder() {
+    while (nextWritten < (int)corpus.size() && corpus[nextWritten].done) {
+        corpusOutput << corpus[nextWritten].records;
+        string().swap(corpus[nextWritten].records);
+        ++nextWritten;
+    }
+}
+
+static string getShardName(int worker) {
+    filesystem::path path(outputName);
+    string extension = path.extension().string();
+
+    path.replace_extension();
+    return path.string() + "." + to_string(worker) + extension;
+}
+
+static void corpusWorker(int worker) {
+    ofstream shard;
+    if (sharded)
+        shard.open(getShardName(worker).c_str(), ios::binary);
+
+    int next;
+    while ((next = nextDemo++) < (int)corpusOrder.size()) {
+        CorpusDemo& demo = corpus[corpusOrder[next]];
+        extractDemo(demo);
+
+        if (sharded) {
+            shard << demo.records;
+            string().swap(demo.records);
+        }
+
+        lock_guard<mutex> lock(writeMutex);
+        demo.done = true;
+
+        if (!sharded)
+            writeInOrder();
+
+        if (!demo.ok)
+            cout << "FAIL  " << demo.path << " (" << demo.error << ")" << endl;
+    }
+}
+
+static bool isDemoFile(const filesystem::path& path) {
+    return path.extension().string().compare(0, 4, ".dm_") == 0;
+}
+
+static bool readCorpus(const string& input) {
+    error_code error;
+    vector<string> paths;
+
+    if (filesystem::is_directory(input, error)) {
+        filesystem::recursive_directory_iterator it(input, error), end;
+
+        for (; !error && it != end; it.increment(error))
+            if (it->is_regular_file(error) && isDemoFile(it->path()))
+                paths.push_back(it->path().string());
+
+        sort(paths.begin(), paths.end());
+    }
+    else {
+        ifstream manifest(input.c_str());
+
+        if (!manifest.is_open()) {
+            cout << "Corpus '" << input << "' could not be opened." << endl;
+            return false;
+        }
+
+        string line;
+        while (getline(manifest, line)) {
+            if (!line.empty() && line[line.size() - 1] == '\r')
+                line.erase(line.size() - 1);
+
+            if (!line.empty() && line[0] != '#')
+                paths.push_back(line);
+        }
+    }
+
+    for (int i = 0; i < (int)paths.size(); ++i) {
+        CorpusDemo demo;
+        demo.path = paths[i];
+        demo.size = (long long)filesystem::file_size(paths[i], error);
+        if (error)
+            demo.size = 0;
+        demo.done = false;
+        demo.ok = false;
+        demo.lines = 0;
+
+        corpus.push_back(demo);
+        corpusOrder.push_back(i);
+    }
+
+    if (sharded) {
+        stable_sort(corpusOrder.begin(), corpusOrder.end(), [](int a, int b) {
+            return corpus[a].size > corpus[b].size;
+        });
+    }
+
+    return true;
+}
+
+static int runCorpus(int argc, char** argv) {
+    int threads = (int)thread::hardware_concurrency();
+    const char* inputName = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+
+        if (arg == "-j" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (arg == "-shard")
+            sharded = true;
+        else if (!inputName)
+            inputName = argv[i];
+        else
+            outputName = argv[i];
+    }
+
+    if (!inputName || outputName.empty()) {
+        cout << "Usage: DemoExtractor -corpus [input] [output] (-j threads) (-shard)" << endl;
+        cout << "   input - directory with demos (searched recursively) or manifest, one demo per line" << endl;
+        cout << "   output - JSON Lines file, one chat line per record" << endl;
+        cout << "   -j threads - number of worker threads (default is number of cores)" << endl;
+        cout << "   -shard - every worker writes its own file (output.N.jsonl), order isnt kept" << endl;
+        return 1;
+    }
+
+    if (!readCorpus(inputName))
+        return 1;
+
+    if (!sharded) {
+        corpusOutput.open(outputName.c_str(), ios::binary);
+
+        if (!corpusOutput.is_open()) {
+            cout << "Output file could not be opened." << endl;
+            return 1;
+        }
+    }
+
+    if (threads < 1)
+        threads = 1;
+    if (threads > (int)corpus.size())
+        threads = max((int)corpus.size(), 1);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    vector<thread> pool;
+    for (int i = 0; i < threads; ++i)
+        pool.push_back(thread(corpusWorker, i));
+    for (int i = 0; i < (int)pool.size(); ++i)
+        pool[i].join();
+
+    int failed = 0;
+    long long lines = 0;
+    for (int i = 0; i < (int)corpus.size(); ++i) {
+        if (!corpus[i].ok)
+            ++failed;
+        lines += corpus[i].lines;
+    }
+
+    long long ms = (long long)chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << corpus.size() - failed << " of " << corpus.size() << " demos, " << lines
+        << " chat lines in " << ms << " ms (" << threads << " threads)" << endl;
+
+    return failed ? 2 : 0;
+}
+
 int main(int argc, char** argv) {
 
+    if (argc >= 2 && !strcmp(argv[1], "-corpus"))
+        return runCorpus(argc, argv);
+
     //-html
     //-text
     //-colored
@@ -104,12 +427,14 @@ int main(int argc, char** argv) {
         cout << "Need more arguments." << endl;
 
         cout << "Usage: DemoExtractor [input] [output] (parameter)" << endl;
-        cout << "   input - input demo file, full name (with .dm_26 extension)" << endl;
+        cout << "   input - input demo file, full name (with .dm_26 extension), - for standard input" << endl;
         cout << "   output - output text/html file, full name (with .htm, .txt or w/e extension)" << endl;
         cout << "   parameter - can be one of following:" << endl;
         cout << "               -text - normal text will be generated (default)" << endl;
         cout << "               -html - special html file with colors will be generated" << endl;
         cout << "               -code - normal text WITH color codes will be generated" << endl;
+        cout << "Usage: DemoExtractor -corpus [input] [output] (-j threads) (-shard)" << endl;
+        cout << "   chat of all demos in directory or manifest to JSON Lines file" << endl;
         return 1;
     }
 
@@ -125,7 +450,7 @@ int main(int argc, char** argv) {
         }
     }
 
-    Demo  inputDemo;
+    DemoReader inputDemo;
     outputFile.open(argv[2]);
 
     if (!inputDemo.open(argv[1])) {
@@ -138,36 +463,28 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    int count = inputDemo.getMessageCount();
-    int lastSeqNumber = 0;
+    //only server commands are needed, snapshots arent decoded at all,
+    //gamestates are read for command sequence of new connection
+    inputDemo.setDecodeDepth(DECODE_GAMESTATE);
+    CommandTracker commandTracker;
 
     if (mod == MOD_HTML) {
         outputFile << "<html>\n<head></head>\n<body bgcolor=gray>\n<b>";
     }
 
-    for (int i = 0; i < count; ++i) {
-        Message* message = inputDemo.getMessage(i);
-
-        if (!message)
-            continue;
+    //messages are read one by one, so chat can be extracted
+    //even from piped input (e.g. zcat demo.dm_26.gz | ...)
+    while (inputDemo.next()) {
+        Message* message = inputDemo.getMessage();
+        commandTracker.removeDuplicates(message);
 
         for (int j = 0; j < message->getInstructionsCount(); ++j) {
             Instruction* instruction = message->getInstruction(j);
             ServerCommand* serverCommand = instruction->getServerCommand();
             if (serverCommand) {
-                int seqNumber = serverCommand->getSequenceNumber();
-
-                if (seqNumber <= lastSeqNumber) {
-                    continue;
-                }
-
-                lastSeqNumber = seqNumber;
-
                 logCommand(serverCommand->getCommand(), mod);
             }
         }
-
-        inputDemo.unloadMessage(i);
     }
 
     if (mod == MOD_HTML) {
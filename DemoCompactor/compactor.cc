@@ -0,0 +1,381 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include "demoreader.h"
+#include "snapshotchain.h"
+#include "quantizer.h"
+#include "entityfilter.h"
+#include "commandtracker.h"
+#include <time.h>
+
+using namespace DemoJKA;
+using namespace std;
+
+/*
+Demo is read in single pass, every snapshot is resolved to full state,
+changed and encoded again against previous output snapshot, so output
+plays as usual. Sequence numbers and other instructions are kept.
+
+When snapshots are downsampled, messages of dropped snapshots arent
+written, their server commands are moved to the next written message.
+Entities removed in dropped snapshots are removed by the next written one,
+as it is delta from the last written snapshot. Sequence numbers of output
+have gaps, which client accepts, delta is only limited by PACKET_BACKUP.
+
+Stripped entities are removed from full snapshots and their baselines from
+gamestate, output encoder uses the stripped gamestate. Input is still
+resolved with the original baselines.
+*/
+
+const float DEFAULT_ORIGIN_STEP = 1.0f;
+const float DEFAULT_ANGLE_STEP = 0.125f;
+
+DemoReader demoReader;
+SnapshotHistory history;
+SnapshotEncoder encoder;
+Quantizer quantizer;
+CommandTracker commandTracker;
+int duplicateCommands = 0;
+int supersededCommands = 0;
+
+//same encoding without quantization, for the report
+SnapshotEncoder reference;
+Snapshot referenceSnap;
+long long referenceBits = 0;
+long long outputBits = 0;
+
+//encoding without stripping, for bytes saved by stripped entities
+EntityFilter entityFilter;
+SnapshotEncoder unstripped;
+Snapshot unstrippedSnap;
+
+int brokenSnapshots = 0;
+
+//downsampling, every keepEvery-th snapshot or snapshot keepInterval ms after the last kept
+int keepEvery = 1;
+int keepInterval = 0;
+int skippedSnapshots = 0;
+int lastKeptTime = 0;
+bool keptSinceGamestate = false;
+vector<Instruction*> pendingCommands; //from dropped messages
+int droppedSnapshots = 0;
+
+int getFirstSnapshotIndex(Message* message) {
+    for (int i = 0; i < message->getInstructionsCount(); ++i)
+        if (message->getInstruction(i)->getType() == INSTR_SNAPSHOT)
+            return i;
+
+    return -1;
+}
+
+/*
+Rounds fields of the group in all state types. Origins are positions,
+angles are orientations and velocities are trajectory deltas.
+*/
+void setGroupStep(const char* group, float step) {
+    static const char* origins[] = { "origin[", "pos.trBase[", 0 };
+    static const char* angles[] = { "angles[", "viewangles[", "apos.trBase[", 0 };
+    static const char* velocities[] = { "velocity[", "pos.trDelta[", "apos.trDelta[", 0 };
+
+    const char** names = (string(group) == "origin") ? origins
+        : (string(group) == "angles") ? angles : velocities;
+
+    for (int t = STATE_DELTAENTITY; t <= STATE_VEHICLESTATE; ++t)
+        for (int i = 0; names[i]; ++i)
+            quantizer.setStep(t, names[i], step);
+}
+
+//comma separated names or numbers of entity types
+bool addStrippedTypes(const string& list) {
+    size_t start = 0;
+
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == string::npos)
+            end = list.size();
+
+        string name = list.substr(start, end - start);
+        int eType = EntityFilter::getTypeByName(name);
+
+        if (eType < 0 && !name.empty() && name.find_first_not_of("0123456789") == string::npos)
+            eType = atoi(name.c_str());
+
+        if (eType < 0) {
+            cout << "Unknown entity type '" << name << "'." << endl;
+            return false;
+        }
+
+        entityFilter.dropType(eType);
+        start = end + 1;
+    }
+
+    return true;
+}
+
+bool addStrippedRange(const string& range) {
+    int first, last;
+
+    if (sscanf(range.c_str(), "%d-%d", &first, &last) != 2
+        || first < 0 || last >= MAX_GENTITIES || first > last) {
+        cout << "Wrong entity range '" << range << "'." << endl;
+        return false;
+    }
+
+    entityFilter.dropRange(first, last);
+    return true;
+}
+
+//first snapshot after gamestate is always kept
+bool isKept(Snapshot* snapshot) {
+    if (!keptSinceGamestate)
+        return true;
+
+    if (keepInterval > 0)
+        return snapshot->getServertime() - lastKeptTime >= keepInterval;
+
+    return skippedSnapshots + 1 >= keepEvery;
+}
+
+//server commands of dropped message go to the next written one
+void moveCommands(Message* message) {
+    for (int i = 0; i < message->getInstructionsCount(); ++i)
+        if (message->getInstruction(i)->getType() == INSTR_SERVERCOMMAND)
+            pendingCommands.push_back(message->getInstruction(i)->clone());
+}
+
+void insertCommands(Message* message) {
+    for (int i = 0; i < (int)pendingCommands.size(); ++i)
+        message->insertInstruction(i, pendingCommands[i]);
+
+    pendingCommands.clear();
+}
+
+/*
+Returns false when message is dropped.
+*/
+bool processMessage(Message* message) {
+    //resent commands, client executes every command once
+    duplicateCommands += commandTracker.removeDuplicates(message);
+
+    for (int i = 0; i < message->getInstructionsCount(); ++i) {
+        Instruction* instr = message->getInstruction(i);
+
+        if (instr->getType() == INSTR_GAMESTATE) {
+            history.reset(instr->getGamestate());
+
+            if (!entityFilter.isEmpty()) {
+                unstripped.reset(instr->getGamestate());
+                entityFilter.filter(instr->getGamestate());
+            }
+
+            encoder.reset(instr->getGamestate());
+            reference.reset(instr->getGamestate());
+            keptSinceGamestate = false;
+        }
+    }
+
+    int index = getFirstSnapshotIndex(message);
+    if (index < 0) {
+        insertCommands(message);
+        return true;
+    }
+
+    Snapshot* snapshot = message->getInstruction(index)->getSnapshot();
+    Snapshot* full = history.add(message->getSeqNumber(), snapshot);
+
+    if (!full) {
+        //delta base isnt known (broken demo), snapshot cant be encoded
+        message->deleteInstruction(index);
+        insertCommands(message);
+        ++brokenSnapshots;
+        return true;
+    }
+
+    if (!isKept(snapshot)) {
+        moveCommands(message);
+        ++skippedSnapshots;
+        ++droppedSnapshots;
+        return false;
+    }
+
+    skippedSnapshots = 0;
+    lastKeptTime = full->getServertime();
+    keptSinceGamestate = true;
+
+    snapshot->assign(full);
+
+    if (!entityFilter.isEmpty()) {
+        unstrippedSnap.assign(full);
+        unstripped.encode(message->getSeqNumber(), &unstrippedSnap);
+        entityFilter.count(full, &unstrippedSnap);
+        entityFilter.filter(snapshot);
+    }
+
+    referenceSnap.assign(snapshot);
+    reference.encode(message->getSeqNumber(), &referenceSnap);
+    referenceBits += referenceSnap.getBitLength();
+
+    quantizer.quantize(snapshot);
+    encoder.encode(message->getSeqNumber(), snapshot);
+    outputBits += snapshot->getBitLength();
+
+    insertCommands(message);
+    return true;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc < 2) {
+        cout << "Wrong arguments format." << endl;
+        cout << "Usage: DemoCompactor [Input] {Output} (-q) (-o step) (-a step) (-v step) (-n count) (-t ms) (-e types) (-r first-last)" << endl;
+        cout << "   -q - lossy quantization, origins are rounded to " << DEFAULT_ORIGIN_STEP
+            << " and angles to " << DEFAULT_ANGLE_STEP << endl;
+        cout << "   -o step - rounding of origins (0 keeps them)" << endl;
+        cout << "   -a step - rounding of angles in degrees (0 keeps them)" << endl;
+        cout << "   -v step - rounding of velocities (default 0, kept)" << endl;
+        cout << "   -n count - keeps every count-th snapshot (2 makes 30 fps demo 15 fps)" << endl;
+        cout << "   -t ms - keeps snapshots at least ms apart in server time (50 for 20 fps)" << endl;
+        cout << "   -e types - strips entity types separated by commas, names or numbers" << endl;
+        cout << "      (e.g. missile,mover,fx,events), all event types are 'events'" << endl;
+        cout << "   -r first-last - strips entity numbers in range (e.g. 64-1022)" << endl;
+        return 1;
+    }
+
+    string demoName = argv[1];
+    string outputName;
+
+    float originStep = 0.0f;
+    float angleStep = 0.0f;
+    float velocityStep = 0.0f;
+
+    //process parameters
+    for (int i = 2; i < argc; ++i) {
+        string para = argv[i];
+
+        if (para == "-q") {
+            originStep = DEFAULT_ORIGIN_STEP;
+            angleStep = DEFAULT_ANGLE_STEP;
+        }
+        else if (para == "-o" && i + 1 < argc) {
+            originStep = (float)atof(argv[++i]);
+        }
+        else if (para == "-a" && i + 1 < argc) {
+            angleStep = (float)atof(argv[++i]);
+        }
+        else if (para == "-v" && i + 1 < argc) {
+            velocityStep = (float)atof(argv[++i]);
+        }
+        else if (para == "-n" && i + 1 < argc) {
+            keepEvery = atoi(argv[++i]);
+            if (keepEvery < 1)
+                keepEvery = 1;
+        }
+        else if (para == "-t" && i + 1 < argc) {
+            keepInterval = atoi(argv[++i]);
+        }
+        else if (para == "-e" && i + 1 < argc) {
+            if (!addStrippedTypes(argv[++i]))
+                return 1;
+        }
+        else if (para == "-r" && i + 1 < argc) {
+            if (!addStrippedRange(argv[++i]))
+                return 1;
+        }
+        else {
+            outputName = para;
+        }
+    }
+
+    if (outputName.empty()) {
+        outputName = demoName;
+
+        size_t extPos = outputName.find_last_of('.');
+
+        if (extPos == string::npos)
+            outputName += "_compact.dm_26";
+        else
+            outputName.insert(extPos, "_compact");
+    }
+
+    setGroupStep("origin", originStep);
+    setGroupStep("angles", angleStep);
+    setGroupStep("velocity", velocityStep);
+
+    if (!demoReader.open(demoName.c_str())) {
+        cout << "Failed to open demo '" << demoName << "'." << endl;
+        return 1;
+    }
+
+    ofstream output(outputName.c_str(), ios::binary);
+    if (!output.is_open()) {
+        cout << "Failed to open output '" << outputName << "'." << endl;
+        return 1;
+    }
+
+    clock_t init = clock();
+
+    try {
+        while (demoReader.next()) {
+            Message* message = demoReader.getMessage();
+
+            if (processMessage(message)) {
+                supersededCommands += CommandTracker::clearSuperseded(message);
+                message->saveMessage(output);
+            }
+        }
+    }
+    catch (exception& e) {
+        cout << "Demo processing failed: " << e.what() << endl;
+        return 1;
+    }
+
+    //commands after the last written snapshot have no message to go to
+    for (int i = 0; i < (int)pendingCommands.size(); ++i)
+        delete pendingCommands[i];
+    pendingCommands.clear();
+
+    //proper ending
+    int end = -1;
+    output.write((char*)&end, 4);
+    output.write((char*)&end, 4);
+
+    long long inputSize = demoReader.getBytesRead();
+    long long outputSize = (long long)output.tellp();
+    output.close();
+
+    double s = (double)(clock() - init) / ((double)CLOCKS_PER_SEC);
+
+    cout << demoReader.getMessageCount() << " messages, " << inputSize << " -> "
+        << outputSize << " bytes." << endl;
+
+    if (!quantizer.isEmpty()) {
+        cout << "Snapshots " << referenceBits / 8 << " bytes without quantization, "
+            << outputBits / 8 << " bytes quantized";
+        if (referenceBits > 0)
+            cout << " (" << (referenceBits - outputBits) * 100 / referenceBits << "% saved)";
+        cout << "." << endl;
+
+        quantizer.report(cout);
+    }
+
+    if (!entityFilter.isEmpty()) {
+        cout << "Stripped entities:" << endl;
+        entityFilter.report(cout);
+    }
+
+    if (duplicateCommands || supersededCommands)
+        cout << duplicateCommands << " resent server commands removed, "
+            << supersededCommands << " overwritten configstrings cleared." << endl;
+
+    if (droppedSnapshots)
+        cout << droppedSnapshots << " snapshots dropped by downsampling." << endl;
+
+    if (brokenSnapshots)
+        cout << brokenSnapshots << " snapshots with unknown delta base dropped." << endl;
+
+    cout << "Done in " << s << "s." << endl;
+    cout << "'" << outputName << "' saved." << endl;
+
+    return 0;
+}
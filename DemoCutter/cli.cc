@@ -0,0 +1,316 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include "cutter.h"
+
+using namespace DemoJKA;
+using namespace std;
+
+/*
+One line of manifest, tab separated:
+
+    input  beginMap  beginTime  endMap  endTime  output
+
+times are in ms from the map start, 0 means beginning/end of the map
+(see Cutter::cut). Empty lines and lines starting with # are skipped.
+*/
+struct Job {
+    string  input;
+    int     beginMap;
+    int     beginTime;
+    int     endMap;
+    int     endTime;
+    string  output;
+
+    //stats
+    bool        ok;
+    double      openTime;   //ms, shared by all jobs of the same input
+    double      cutTime;    //ms, shared by all jobs cut in one batch
+    long long   size;       //bytes written
+    string      error;
+
+    Job() : beginMap(0), beginTime(0), endMap(0), endTime(0),
+        ok(false), openTime(0), cutTime(0), size(0) {};
+};
+
+//jobs of one input file, demo is opened and analysed only once for them
+struct Group {
+    string      input;
+    vector<int> jobs;
+};
+
+static vector<Job>      jobs;
+static vector<Group>    groups;
+static atomic<int>      nextGroup(0);
+static mutex            logMutex;
+
+static double elapsed(chrono::steady_clock::time_point since) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - since).count();
+}
+
+static bool readManifest(istream& is) {
+    string line;
+    int lineNumber = 0;
+
+    while (getline(is, line)) {
+        ++lineNumber;
+
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        vector<string> columns;
+        stringstream stream(line);
+        string column;
+        while (getline(stream, column, '\t'))
+            columns.push_back(column);
+
+        Job job;
+        if (columns.size() != 6) {
+            cout << "Manifest line " << lineNumber << ": expected 6 columns." << endl;
+            return false;
+        }
+
+        job.input = columns[0];
+        job.output = columns[5];
+
+        char* end;
+        int* values[] = { &job.beginMap, &job.beginTime, &job.endMap, &job.endTime };
+        for (int i = 0; i < 4; ++i) {
+            *values[i] = (int)strtol(columns[i + 1].c_str(), &end, 10);
+
+            if (*end != 0 || end == columns[i + 1].c_str() || *values[i] < 0) {
+                cout << "Manifest line " << lineNumber << ": wrong number '" << columns[i + 1] << "'." << endl;
+                return false;
+            }
+        }
+
+        jobs.push_back(job);
+    }
+
+    //group jobs by input, order of inputs is kept
+    for (int i = 0; i < (int)jobs.size(); ++i) {
+        int g;
+        for (g = 0; g < (int)groups.size(); ++g)
+            if (groups[g].input == jobs[i].input)
+                break;
+
+        if (g == (int)groups.size()) {
+            groups.push_back(Group());
+            groups.back().input = jobs[i].input;
+        }
+
+        groups[g].jobs.push_back(i);
+    }
+
+    return true;
+}
+
+static void cutSingle(Demo& demo, Job& job) {
+    try {
+        ofstream output(job.output.c_str(), ios::binary);
+
+        if (!output.is_open()) {
+            job.error = "output file could not be opened";
+            return;
+        }
+
+        Cutter::cut(&demo, job.beginMap, job.beginTime, job.endMap, job.endTime, output);
+        job.ok = !output.fail();
+
+        if (!job.ok)
+            job.error = "writing failed";
+    }
+    catch (exception& e) {
+        job.error = e.what();
+    }
+}
+
+static void runGroup(Group& group) {
+    //each worker has its own demo, decoding state is per thread
+    Demo demo;
+    string openError;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    try {
+        if (!demo.open(group.input.c_str(), false))
+            openError = "input demo could not be opened";
+        else
+            demo.analyse();
+    }
+    catch (exception& e) {
+        openError = string("analysis failed: ") + e.what();
+    }
+
+    double openTime = elapsed(start);
+
+    //valid jobs are cut together in one pass over the demo
+    vector<CutRange> ranges;
+    vector<int> batch;
+
+    for (int i = 0; i < (int)group.jobs.size(); ++i) {
+        Job& job = jobs[group.jobs[i]];
+        job.openTime = openTime;
+
+        if (!openError.empty()) {
+            job.error = openError;
+        }
+        else if (job.beginMap >= demo.getMapsCount() || job.endMap >= demo.getMapsCount()) {
+            job.error = "map index out of range";
+        }
+        else {
+            ranges.push_back(CutRange(job.beginMap, job.beginTime, job.endMap, job.endTime, job.output));
+            batch.push_back(group.jobs[i]);
+        }
+    }
+
+    if (!ranges.empty()) {
+        start = chrono::steady_clock::now();
+
+        try {
+            Cutter::cut(&demo, ranges);
+
+            for (int i = 0; i < (int)batch.size(); ++i)
+                jobs[batch[i]].ok = true;
+        }
+        catch (exception&) {
+            //batch fails as a whole, jobs are cut one by one to find out which one is wrong
+            for (int i = 0; i < (int)batch.size(); ++i)
+                cutSingle(demo, jobs[batch[i]]);
+        }
+
+        double cutTime = elapsed(start);
+
+        for (int i = 0; i < (int)batch.size(); ++i) {
+            Job& job = jobs[batch[i]];
+            job.cutTime = cutTime;
+
+            if (job.ok) {
+                ifstream output(job.output.c_str(), ios::binary | ios::ate);
+                job.size = (long long)output.tellg();
+            }
+        }
+    }
+
+    lock_guard<mutex> lock(logMutex);
+    for (int i = 0; i < (int)group.jobs.size(); ++i) {
+        const Job& job = jobs[group.jobs[i]];
+
+        cout << (job.ok ? "OK    " : "FAIL  ") << job.output;
+        if (!job.ok)
+            cout << " (" << job.error << ")";
+        cout << endl;
+    }
+}
+
+static void worker() {
+    int g;
+    while ((g = nextGroup++) < (int)groups.size())
+        runGroup(groups[g]);
+}
+
+static void writeStats(ostream& os) {
+    os << "output\tinput\tstatus\topen_ms\tcut_ms\tbytes\terror" << endl;
+
+    for (int i = 0; i < (int)jobs.size(); ++i) {
+        const Job& job = jobs[i];
+        os << job.output << '\t' << job.input << '\t' << (job.ok ? "ok" : "failed") << '\t'
+            << (long long)job.openTime << '\t' << (long long)job.cutTime << '\t'
+            << job.size << '\t' << job.error << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int threads = (int)thread::hardware_concurrency();
+    const char* statsName = 0;
+    const char* manifestName = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+
+        if (arg == "-j" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (arg == "-s" && i + 1 < argc)
+            statsName = argv[++i];
+        else
+            manifestName = argv[i];
+    }
+
+    if (!manifestName) {
+        cout << "Need more arguments." << endl;
+
+        cout << "Usage: DemoCutterCli (-j threads) (-s stats) [manifest]" << endl;
+        cout << "   manifest - tab separated file, one cut per line, - for standard input:" << endl;
+        cout << "              input beginMap beginTime endMap endTime output" << endl;
+        cout << "              times are in ms from map start, 0 means start/end of map" << endl;
+        cout << "   -j threads - number of worker threads (default is number of cores)" << endl;
+        cout << "   -s stats - file for per-cut stats (tab separated), - for standard output" << endl;
+        return 1;
+    }
+
+    bool read;
+    if (string(manifestName) == "-") {
+        read = readManifest(cin);
+    }
+    else {
+        ifstream manifest(manifestName);
+
+        if (!manifest.is_open()) {
+            cout << "Manifest could not be opened." << endl;
+            return 1;
+        }
+
+        read = readManifest(manifest);
+    }
+
+    if (!read)
+        return 1;
+
+    if (threads < 1)
+        threads = 1;
+    if (threads > (int)groups.size())
+        threads = (int)groups.size();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    vector<thread> pool;
+    for (int i = 0; i < threads; ++i)
+        pool.push_back(thread(worker));
+    for (int i = 0; i < (int)pool.size(); ++i)
+        pool[i].join();
+
+    int failed = 0;
+    for (int i = 0; i < (int)jobs.size(); ++i)
+        if (!jobs[i].ok)
+            ++failed;
+
+    cout << jobs.size() - failed << " of " << jobs.size() << " cuts done in "
+        << (long long)elapsed(start) << " ms (" << threads << " threads)" << endl;
+
+    if (statsName) {
+        if (string(statsName) == "-") {
+            writeStats(cout);
+        }
+        else {
+            ofstream stats(statsName);
+
+            if (!stats.is_open()) {
+                cout << "Stats file could not be opened." << endl;
+                return 1;
+            }
+
+            writeStats(stats);
+        }
+    }
+
+    return failed ? 2 : 0;
+}
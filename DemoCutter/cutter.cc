@@ -1,8 +1,10 @@
 #include "cutter.h"
 
+#ifdef _MSC_VER
 #pragma comment(lib, "dwrite")
+#endif
 
-Snapshot* getFirstSnapshot(Message* message) {
+static Snapshot* getFirstSnapshot(Message* message) {
     for (int i = 0; i < message->getInstructionsCount(); ++i)
         if (message->getInstruction(i)->getType() == INSTR_SNAPSHOT)
             return message->getInstruction(i)->getSnapshot();
@@ -10,369 +12,671 @@ Snapshot* getFirstSnapshot(Message* message) {
     return 0;
 }
 
-int getStartTime(Demo* demo, int mapIndex) {
-    Message* firstMessage = demo->getMessage(demo->getMapId(mapIndex));
-    if (!firstMessage)
-        return -1;
-
-    int ret;
-
-    if (demo->isMapRestart(mapIndex)) {
-        //ok map restart, we should find new map time in server command
-        ServerCommand* command;
-        std::string str;
-        for (int i = 0; i < firstMessage->getInstructionsCount(); ++i) {
-            if (command = firstMessage->getInstruction(i)->getServerCommand()) {
-                str = command->getCommand();
-                if (str.substr(0, 6) == "cs 21 ") {
-                    std::stringstream stream(str.substr(7, str.size() - 7 - 2));
-                    if ((stream >> ret)) {
-                        return ret;
-                    }
-                }
-            }
-        }
+/*
+Gives index of the last non restart map, which is the map with gamestate.
+*/
+static int getGamestateMap(Demo* demo, int mapIndex) {
+    while (mapIndex > 0 && demo->isMapRestart(mapIndex))
+        --mapIndex;
 
-        throw DemoException("restart time extraction failed");
-    }
-    else { //new map begins
-        // we find new time directly in gamestate
-        //configstring 21
-        Gamestate* gamestate;
-        for (int i = 0; i < firstMessage->getInstructionsCount(); ++i) {
-            gamestate = firstMessage->getInstruction(i)->getGamestate();
-
-            if (gamestate) {
-                std::stringstream stream(gamestate->getConfigstring(21));
-                if (!(stream >> ret))
-                    throw DemoException("gamestate time extraction failed");
-                return ret;
-            }
-        }
-    }
+    return mapIndex;
+}
+
+static int getNextMapId(Demo* demo, int mapIndex) {
+    if (mapIndex < demo->getMapsCount() - 1)
+        return demo->getMapId(mapIndex + 1);
 
-    return -1;
+    return demo->getMessageCount();
 }
 
-int getSnapshotTime(Message* message) {
+static void reportProgress(ProgressListener* listener, int done, int total) {
+    if (listener && (done % 64) == 0 && !listener->progress(done, total))
+        throw DemoException("cutting cancelled");
+}
+
+/*
+Returns own copy of the message, which can be modified without
+affecting demo. Message isnt kept loaded in demo, unless it was before.
+*/
+Message* Cutter::copyMessage(Demo* demo, int id) {
+    bool wasLoaded = demo->isMessageLoaded(id, DECODE_FULL);
+
+    Message* message = demo->getMessage(id);
     if (!message)
-        return -1;
+        throw DemoException("message loading failed");
 
-    Snapshot* snapshot = getFirstSnapshot(message);
+    Message* copy = message->clone();
 
-    if (snapshot)
-        return snapshot->getServertime();
+    if (!wasLoaded)
+        demo->unloadMessage(id);
 
-    return -1;
+    return copy;
 }
 
-void Cutter::cutFromTime(Demo* demo, int time, int mapIndex) {
-    assert(demo);
+/*
+Finds index of message with given sequence number, id is where the search
+starts. Sequence numbers are in index, so nothing is loaded.
+*/
+int Cutter::findMessage(Demo* demo, int id, int seqNumber) {
+    int count = demo->getMessageCount();
+
+    if (id >= count)
+        id = count - 1;
+    if (id < 0)
+        id = 0;
+
+    //sequence numbers grow with message index
+    while (id > 0 && demo->getMessageSeqNumber(id) > seqNumber)
+        --id;
+    while (id < count - 1 && demo->getMessageSeqNumber(id) < seqNumber)
+        ++id;
+
+    if (demo->getMessageSeqNumber(id) != seqNumber) {
+        std::stringstream msg;
+        msg << "delta time resolving failed (" << seqNumber << ")";
+        throw DemoException(msg.str().c_str());
+    }
+
+    return id;
+}
+
+/*
+Applies whole chain of delta messages on snapshot of message id,
+so it contains full information.
+*/
+void Cutter::uncompressSnapshot(Demo* demo, int id, Snapshot* snapshot) {
+    int delta = snapshot->getDeltanum();
+    int seekingSeqNumber = demo->getMessageSeqNumber(id) - delta;
+    int u = id - delta;
+
+    while (delta != 0) {
+        if (u < 0)
+            throw DemoException("trying do delta from too old message");
+
+        u = findMessage(demo, u, seekingSeqNumber);
+
+        bool wasLoaded = demo->isMessageLoaded(u, DECODE_FULL);
+        Message* message = demo->getMessage(u);
+        Snapshot* deltaSnapshot = message ? getFirstSnapshot(message) : 0;
+
+        if (!deltaSnapshot)
+            throw DemoException("delta snapshot not found");
+
+        snapshot->applyOn(deltaSnapshot);
+
+        delta = deltaSnapshot->getDeltanum();
+        seekingSeqNumber = demo->getMessageSeqNumber(u) - delta;
+
+        if (!wasLoaded)
+            demo->unloadMessage(u);
+
+        u -= delta;
+    }
+}
+
+/*
+Returns index of the first message which is not part of the output.
+*/
+int Cutter::findEnd(Demo* demo, int time, int mapIndex) {
     assert(time >= 0);
     assert(mapIndex >= 0);
 
-    int gameStateIndex;
-    bool isRestart = demo->isMapRestart(mapIndex);
+    int count = demo->getMessageCount();
 
-    if (time == 0 && !isRestart) {
-        gameStateIndex = demo->getMapId(mapIndex);
-        if (gameStateIndex > 0)
-            demo->deleteMessage(0, gameStateIndex - 1);
-        return;
-    }
+    if (time == 0) {
+        if (mapIndex + 1 == demo->getMapsCount())
+            return count; //last map index, time 0, nothing to do
+
+        //lets see when next map appears
+        int end = demo->getMapId(mapIndex + 1);
+
+        if (!demo->isMapRestart(mapIndex + 1)) {
+            //check last few messages and remove mapChange sequence
+            int index = end - 33;
+            if (index < 0)
+                index = 0;
 
-    int newMapindex = mapIndex;
-    if (isRestart) {
-        //find last precending non restart map
-        while (demo->isMapRestart(newMapindex))
-            --newMapindex;
+            for (; index < end; ++index) {
+                bool wasLoaded = demo->isMessageLoaded(index);
+                Message* msg = demo->getMessage(index, DECODE_HEADER);
+                bool found = false;
+
+                for (int j = 0; msg && j < msg->getInstructionsCount(); ++j) {
+                    if (msg->getInstruction(j)->getType() == INSTR_MAPCHANGE) {
+                        found = true;
+                        break;
+                    }
+                }
+
+                if (!wasLoaded)
+                    demo->unloadMessage(index);
+
+                if (found)
+                    return index;
+            }
+        }
+
+        return end;
     }
-    gameStateIndex = demo->getMapId(newMapindex);
 
-    demo->loadMessage(gameStateIndex);
-    demo->loadMessage(gameStateIndex + 1);
-    Gamestate* gamestate = 0;
+    //server times are indexed by analyse()
+    return demo->findMessageAtTime(mapIndex, time);
+}
+
+/*
+Returns index of the first message of the output, which has to be rebuilt.
+*/
+int Cutter::findBegin(Demo* demo, int time, int mapIndex) {
+    int begin;
+
+    if (time != 0)
+        begin = demo->findMessageAtTime(mapIndex, time);
+    else
+        begin = demo->getMapId(mapIndex); //restart
+
+    if (begin >= getNextMapId(demo, mapIndex))
+        throw DemoException("starting time was not found");
+
+    return begin;
+}
+
+/*
+Returns copy of gamestate message, only gamestate instruction is kept.
+Its configstrings are replaced by those valid after message configstringsId.
+*/
+Message* Cutter::copyGamestateMessage(Demo* demo, int id, int configstringsId) {
+    Message* gamestateMessage = copyMessage(demo, id);
 
-    Message* tmpMessage = demo->getMessage(gameStateIndex);
-    int id;
-    for (id = 0; id < tmpMessage->getInstructionsCount(); ++id) {
-        if (tmpMessage->getInstruction(id)->getType() == INSTR_GAMESTATE) {
-            gamestate = tmpMessage->getInstruction(id)->getGamestate();
+    int i;
+    for (i = 0; i < gamestateMessage->getInstructionsCount(); ++i) {
+        if (gamestateMessage->getInstruction(i)->getType() == INSTR_GAMESTATE)
             break;
-        }
     }
 
-    if (id < tmpMessage->getInstructionsCount() - 1) {
+    if (i == gamestateMessage->getInstructionsCount()) {
+        delete gamestateMessage;
+        throw DemoException("gamestate instruction not found in message");
+    }
+
+    if (i < gamestateMessage->getInstructionsCount() - 1) {
         //there are some instructions after gamestate, delete
-        tmpMessage->deleteInstruction(id + 1, tmpMessage->getInstructionsCount() - id - 1);
+        gamestateMessage->deleteInstruction(i + 1, gamestateMessage->getInstructionsCount() - i - 1);
     }
 
-    if (id > 0) {
+    if (i > 0) {
         //there are some instructions before gamestate, delete
-        tmpMessage->deleteInstruction(0, id);
+        gamestateMessage->deleteInstruction(0, i);
     }
 
-    if (!gamestate)
-        throw DemoException("gamestate instruction not found in message");
+    //tracker has them already, no need to replay server commands
+    ConfigstringTracker::stringmap strings;
+    demo->getConfigstrings(configstringsId, strings);
+    gamestateMessage->getInstruction(0)->getGamestate()->setConfigstrings(strings);
 
-    int starttime = getStartTime(demo, mapIndex);
-    int i = gameStateIndex + 1;
+    return gamestateMessage;
+}
 
-    int nextMapMessageindex;
+/*
+Writes beginning of the cut demo: gamestate message and message id with
+uncompressed snapshot. Gamestate message is modified. Returns copy of
+message id, which is needed for delta compression of following messages.
+*/
+Message* Cutter::writeStart(Demo* demo, int id, Message* gamestateMessage, std::ostream& os) {
+    Message* firstMessage = copyMessage(demo, id);
+
+    try {
+        //TO DO: for restart delete unnecesarry server commands from first
+        //message, they are already applied on gamestate
+
+        //we are gonna make this message to be our first, not compressed
+        Snapshot* firstSnapshot = getFirstSnapshot(firstMessage);
+        if (!firstSnapshot)
+            throw DemoException("snapshot not found in first message");
+
+        uncompressSnapshot(demo, id, firstSnapshot);
+        firstSnapshot->setDeltanum(0);
+        firstSnapshot->makeInit();//removing null characters
+
+        //need correction because of deltanums etc
+        if (id + 1 < demo->getMessageCount()) {
+            bool wasLoaded = demo->isMessageLoaded(id + 1);
+            Message* nextMessage = demo->getMessage(id + 1, DECODE_HEADER);
+
+            if (!nextMessage)
+                throw DemoException("message loading failed");
+
+            gamestateMessage->setSeqNumber(nextMessage->getSeqNumber() - 2);
+            firstMessage->setSeqNumber(nextMessage->getSeqNumber() - 1);
+            gamestateMessage->setRelAcknowledge(nextMessage->getRelAcknowledge());
+            firstMessage->setRelAcknowledge(nextMessage->getRelAcknowledge());
+
+            if (!wasLoaded)
+                demo->unloadMessage(id + 1);
+        }
 
-    if (mapIndex < demo->getMapsCount() - 1)
-        nextMapMessageindex = demo->getMapId(mapIndex + 1);
-    else
-        nextMapMessageindex = demo->getMessageCount();
+        gamestateMessage->saveMessage(os);
+        firstMessage->saveMessage(os);
+    }
+    catch (std::exception&) {
+        delete firstMessage;
+        throw;
+    }
 
-    int msgsCount = demo->getMessageCount();
+    return firstMessage;
+}
 
-    //int firstSnapshotIndex = demo->getMapId(mapIndex);
-    //update our gamestate whole way to the selected time
-    while (i < nextMapMessageindex) {
-        demo->loadMessage(i);
+/*
+Full snapshots of messages at the cut start, first message included.
+Rebuilt snapshot can be delta from any of them (all are in output already),
+the one which gives smallest encoding is used. Sizes are only counted,
+nothing is written. Client keeps entities of last snapshots in ring of
+MAX_PARSE_ENTITIES, so entities of every written snapshot are counted and
+base is used only while its entities are still there. When even the first
+snapshot is too old, rebuilt snapshot is written uncompressed.
+*/
+class DeltaBases {
+private:
+    std::vector<Snapshot*>  snapshots;
+    std::vector<int>        ids;
+    std::vector<int>        parseNumbers;   //parsed before snapshot
+    int                     parsed;         //entities of all snapshots
+    Snapshot                candidate;
+
+public:
+    DeltaBases() : parsed(0) {};
+    ~DeltaBases() { clear(); };
+
+    void clear() {
+        for (int i = 0; i < (int)snapshots.size(); ++i)
+            delete snapshots[i];
+
+        snapshots.clear();
+        ids.clear();
+        parseNumbers.clear();
+        parsed = 0;
+    }
 
-        if (((time != 0 && (getSnapshotTime(demo->getMessage(i)) - starttime) >= time))
-            || (time == 0 && isRestart && i == demo->getMapId(mapIndex))
-            ) {
-            break;
-        }
+    //keeps copy of full snapshot of message id as base
+    void add(int id, Snapshot* full) {
+        Snapshot* copy = full->clone();
+        copy->setDeltanum(0);
+        copy->makeInit();
 
-        for (int j = 0; j < demo->getMessage(i)->getInstructionsCount(); ++j) {
-            if (demo->getMessage(i)->getInstruction(j)->getType() == INSTR_SERVERCOMMAND)
-                gamestate->update(demo->getMessage(i)->getInstruction(j)->getServerCommand());
-        }
+        snapshots.push_back(copy);
+        ids.push_back(id);
+        parseNumbers.push_back(parsed);
+        parsed += copy->getEntitiesCount();
+    }
 
-        if (i > gameStateIndex) //unload unless it is the initial gamestate message
-            demo->unloadMessage(i);
+    /*
+    Keeps snapshot of message id, which is written as it is, it is delta
+    from message baseId (-1 for uncompressed one) which has to be kept here.
+    */
+    void follow(int id, int baseId, Snapshot* snapshot) {
+        Snapshot* full = snapshot->clone();
 
-        ++i;
-    }
-    /* i is now index to the very first snapshot for new demo */
+        if (baseId >= 0) {
+            int i = (int)(std::find(ids.begin(), ids.end(), baseId) - ids.begin());
 
-    if (i == nextMapMessageindex)
-        throw DemoException("starting time was not found");
+            if (i == (int)ids.size()) {
+                delete full;
+                throw DemoException("delta base of following message not found");
+            }
 
-    if (isRestart) {
-        //for restart we need to update gamestate from
-        //next message AND delete those server commands
-        for (int j = 0; j < demo->getMessage(i)->getInstructionsCount(); ++j) {
-            if (demo->getMessage(i)->getInstruction(j)->getType() == INSTR_SERVERCOMMAND)
-                gamestate->update(demo->getMessage(i)->getInstruction(j)->getServerCommand());
+            full->applyOn(snapshots[i]);
         }
 
-        //TO DO: delete unnecesarry server commands from next message 
-        //(which should be first snapshot in new demo)
+        add(id, full);
+        delete full;
     }
 
-    //we are gonna make the next message to be our first, not compressed
-    int delta = getFirstSnapshot(demo->getMessage(i))->getDeltanum();
-    int u = i - delta;
-    int max_u, min_u;
-    int seekingSeqNumber = demo->getMessage(i)->getSeqNumber() - delta;
-    while (delta != 0) {
+    /*
+    Makes full snapshot of message id delta from the best base, its full copy
+    is kept as base for next snapshots.
+    */
+    void delta(int id, Snapshot* snapshot) {
+        Snapshot* full = snapshot->clone();
+        int best = -1;
+        int bestBits = 0;
+
+        for (int i = 0; i < (int)snapshots.size(); ++i) {
+            //first snapshot is always there, others only when client keeps them
+            if (i > 0 && id - ids[i] >= PACKET_BACKUP)
+                continue;
+
+            //"Delta parseEntitiesNum too old"
+            if (parsed - parseNumbers[i] > MAX_PARSE_ENTITIES - 128)
+                continue;
+
+            candidate.assign(snapshot);
+            candidate.delta(snapshots[i]);
+            candidate.removeNotChanged();
+            candidate.setDeltanum(id - ids[i]);
+
+            int bits = candidate.getBitLength();
+            if (best < 0 || bits < bestBits) {
+                best = i;
+                bestBits = bits;
+            }
+        }
 
-        demo->loadMessage(u);
+        if (best >= 0) {
+            snapshot->delta(snapshots[best]);
+            snapshot->removeNotChanged();
+            snapshot->setDeltanum(id - ids[best]);
+        }
+        else {
+            snapshot->setDeltanum(0);
+            snapshot->makeInit();
+        }
 
-        min_u = 0;
-        max_u = msgsCount - 1;
-        while (demo->getMessage(u) && min_u + 1 < max_u /* not infinite loop*/
-            && demo->getMessage(u)->getSeqNumber() != seekingSeqNumber) {
-            demo->unloadMessage(u);
+        add(id, full);
+        delete full;
+    }
+};
+
+/*
+Writes message id which follows first message of the cut demo (firstId).
+Its snapshot can be delta from message before the cut, in that case
+it is made delta from the first snapshot or from earlier following one
+instead (see DeltaBases). Only 32 messages after the first one need this,
+their full snapshots are kept in bases.
+*/
+void Cutter::writeFollowing(Demo* demo, int id, int firstId, DeltaBases& bases,
+    std::ostream& os) {
+    bool wasLoaded = demo->isMessageLoaded(id);
+    Snapshot* snap = getFirstSnapshot(demo->getMessage(id, DECODE_HEADER));
+    bool hasSnapshot = snap != 0;
+    bool rebuild = snap && (snap->getDeltanum() > (id - firstId));
+
+    if (!wasLoaded)
+        demo->unloadMessage(id);
+
+    if (!hasSnapshot) {
+        demo->saveMessage(id, os);
+        return;
+    }
 
-            if (seekingSeqNumber < demo->getMessage(u)->getSeqNumber()) {
-                //going down with u
-                max_u = u;
-                --u;
-            }
-            else {
-                //going up with u
-                min_u = u;
-                ++u;
-            }
+    Message* message = copyMessage(demo, id);
+    snap = getFirstSnapshot(message);
 
-            demo->loadMessage(u);
+    try {
+        if (rebuild) {
+            uncompressSnapshot(demo, id, snap);
+            bases.delta(id, snap);
+            message->saveMessage(os);
         }
+        else {
+            //written as it is, but later ones can be delta from it
+            int delta = snap->getDeltanum();
+            int baseId = delta ? findMessage(demo, id - delta, demo->getMessageSeqNumber(id) - delta) : -1;
 
-        if (!demo->getMessage(u) || min_u + 1 == max_u) {
-            std::string msg = "delta time resolving failed ";
-            msg += "(";
-            msg += seekingSeqNumber;
-            msg += ")";
-            throw DemoException(msg.c_str());
+            bases.follow(id, baseId, snap);
+            demo->saveMessage(id, os);
         }
+    }
+    catch (std::exception&) {
+        delete message;
+        throw;
+    }
 
-        getFirstSnapshot(demo->getMessage(i))->applyOn(getFirstSnapshot(demo->getMessage(u)));
+    delete message;
+}
 
-        delta = getFirstSnapshot(demo->getMessage(u))->getDeltanum();
-        seekingSeqNumber = demo->getMessage(u)->getSeqNumber() - delta;
-        demo->unloadMessage(u);
-        u -= delta;
+void Cutter::cut(Demo* demo, int beginMapIndex, int beginTime,
+    int endMapIndex, int endTime, std::ostream& os, ProgressListener* listener) {
+    assert(demo);
+    assert(beginTime >= 0);
+    assert(beginMapIndex >= 0);
+
+    //projected messages are incomplete
+    if (demo->getProjection())
+        throw DemoException("demo with projection cant be cut");
+
+    int end = findEnd(demo, endTime, endMapIndex);
+    int i;
+
+    bool isRestart = demo->isMapRestart(beginMapIndex);
 
+    if (beginTime == 0 && !isRestart) {
+        //whole map from gamestate, nothing to rebuild
+        int begin = demo->getMapId(beginMapIndex);
+        for (i = begin; i < end; ++i) {
+            reportProgress(listener, i - begin, end - begin);
+            demo->saveMessage(i, os);
+        }
+        return;
     }
-    getFirstSnapshot(demo->getMessage(i))->setDeltanum(0);
-    getFirstSnapshot(demo->getMessage(i))->makeInit();//removing null characters
-
-    //need correction because of deltanums etc
-    //not sure if this has to be here
-    demo->loadMessage(i + 1);
-    demo->getMessage(gameStateIndex)->setSeqNumber(demo->getMessage(i + 1)->getSeqNumber() - 2);
-    demo->getMessage(i)->setSeqNumber(demo->getMessage(i + 1)->getSeqNumber() - 1);
-    demo->getMessage(gameStateIndex)->setRelAcknowledge(demo->getMessage(i + 1)->getRelAcknowledge());
-    demo->getMessage(i)->setRelAcknowledge(demo->getMessage(i + 1)->getRelAcknowledge());
-
-    Snapshot* snap;
-    for (int j = i + 1; j < i + 33; ++j) {//need to check only 32 snapshots at most
-        if (j == nextMapMessageindex)
-            break; // needed no more
-
-        demo->loadMessage(j);
-
-        snap = getFirstSnapshot(demo->getMessage(j));
-
-        if (snap && (snap->getDeltanum() > (j - i))) {
-
-            delta = getFirstSnapshot(demo->getMessage(j))->getDeltanum();
-            seekingSeqNumber = demo->getMessage(j)->getSeqNumber() - delta;
-            u = j - delta;
-            while (delta != 0) {
-                if (u <= 0)
-                    throw DemoException("trying do delta from too old message");
-
-                demo->loadMessage(u);
-
-                min_u = 0;
-                max_u = msgsCount - 1;
-                while (demo->getMessage(u) && min_u + 1 < max_u /* not infinite loop*/
-                    && demo->getMessage(u)->getSeqNumber() != seekingSeqNumber) {
-                    demo->unloadMessage(u);
-
-                    if (seekingSeqNumber < demo->getMessage(u)->getSeqNumber()) {
-                        //going down with u
-                        max_u = u;
-                        --u;
-                    }
-                    else {
-                        //going up with u
-                        min_u = u;
-                        ++u;
-                    }
 
-                    demo->loadMessage(u);
-                }
+    int gameStateIndex = demo->getMapId(getGamestateMap(demo, beginMapIndex));
+    Message* gamestateMessage = 0;
+    Message* firstMessage = 0;
 
-                if (!demo->getMessage(u) || min_u + 1 == max_u) {
-                    std::string msg = "delta time resolving failed ";
-                    msg += "(";
-                    msg += seekingSeqNumber;
-                    msg += ")";
-                    throw DemoException(msg.c_str());
-                }
+    try {
+        int nextMapMessageindex = getNextMapId(demo, beginMapIndex);
 
-                snap->applyOn(getFirstSnapshot(demo->getMessage(u)));
+        if (nextMapMessageindex > end)
+            nextMapMessageindex = end;
 
-                delta = getFirstSnapshot(demo->getMessage(u))->getDeltanum();
+        i = findBegin(demo, beginTime, beginMapIndex);
 
-                //u or i
-                seekingSeqNumber = demo->getMessage(u)->getSeqNumber() - delta;
+        if (i >= nextMapMessageindex)
+            throw DemoException("starting time was not found");
 
-                demo->unloadMessage(u);
-                u -= delta;
+        //gamestate as it was at the first message, for restart
+        //server commands of the first message are included
+        gamestateMessage = copyGamestateMessage(demo, gameStateIndex, isRestart ? i : i - 1);
+        firstMessage = writeStart(demo, i, gamestateMessage, os);
 
-            }
-            snap->delta(getFirstSnapshot(demo->getMessage(i)));
+        //following snapshots can be delta from messages before the first one,
+        //need to check only 32 snapshots at most
+        DeltaBases bases;
+        bases.add(i, getFirstSnapshot(firstMessage));
 
-            snap->setDeltanum(j - i);
-        }
-        else {
-            demo->unloadMessage(j);
+        int j;
+        for (j = i + 1; j < i + 33 && j < nextMapMessageindex; ++j)
+            writeFollowing(demo, j, i, bases, os);
+
+        //rest is not affected by cut
+        for (; j < end; ++j) {
+            reportProgress(listener, j - i, end - i);
+            demo->saveMessage(j, os);
         }
+    }
+    catch (std::exception&) {
+        delete gamestateMessage;
+        delete firstMessage;
+        throw;
+    }
+
+    delete gamestateMessage;
+    delete firstMessage;
+}
+
+bool Cutter::cut(Demo* demo, int beginMapIndex, int beginTime,
+    int endMapIndex, int endTime, const char* filename, ProgressListener* listener) {
+    std::ofstream output(filename, std::ios::binary);
+
+    if (!output.is_open())
+        return false;
+
+    cut(demo, beginMapIndex, beginTime, endMapIndex, endTime, output, listener);
+
+    return true;
+}
 
+/*
+State of one range during batch cut.
+*/
+struct BatchRange {
+    enum {
+        PENDING,
+        ACTIVE,
+        FINISHED
+    };
+
+    const CutRange* range;
+    int             state;
+    bool            rebuild;        //output begins with rebuilt gamestate
+    bool            isRestart;
+    int             beginId;        //first message when not rebuilt, gamestate otherwise
+    int             beginLimit;     //next map after begin map
+    int             firstId;        //first message of output when rebuilt
+    int             end;            //first message which is not part of the output
+    int             windowEnd;      //messages to this one can be delta from before cut
+    Message*        firstMessage;
+    DeltaBases*     bases;
+    std::ofstream*  output;
+
+    BatchRange() : firstMessage(0), bases(0), output(0) {};
+};
+
+static void clearBatch(std::vector<BatchRange>& batch) {
+    for (int i = 0; i < (int)batch.size(); ++i) {
+        delete batch[i].firstMessage;
+        delete batch[i].bases;
+        delete batch[i].output;
+        batch[i].firstMessage = 0;
+        batch[i].bases = 0;
+        batch[i].output = 0;
     }
+}
 
-    demo->deleteMessage(gameStateIndex + 1, i);
+static void openOutput(BatchRange& range) {
+    range.output = new std::ofstream(range.range->filename.c_str(), std::ios::binary);
 
-    if (gameStateIndex > 0) {
-        //not first map in demo, we also need to delete
-        //all messages from beginning
-        demo->deleteMessage(0, gameStateIndex);
+    if (!range.output->is_open()) {
+        std::string s = "output file cant be opened: " + range.range->filename;
+        throw DemoException(s.c_str());
     }
+
+    range.state = BatchRange::ACTIVE;
 }
 
-void Cutter::cutToTime(Demo* demo, int time, int mapIndex) {
+static void closeOutput(BatchRange& range) {
+    delete range.firstMessage;
+    delete range.bases;
+    delete range.output;
+    range.firstMessage = 0;
+    range.bases = 0;
+    range.output = 0;
+    range.state = BatchRange::FINISHED;
+}
+
+void Cutter::cut(Demo* demo, const std::vector<CutRange>& ranges) {
     assert(demo);
-    assert(time >= 0);
-    assert(mapIndex >= 0);
 
-    int starttime = getStartTime(demo, mapIndex);
+    //projected messages are incomplete
+    if (demo->getProjection())
+        throw DemoException("demo with projection cant be cut");
 
-    int snapTime;
-    int i;
+    if (ranges.empty())
+        return;
 
-    if (time == 0) {
-        if (mapIndex + 1 == demo->getMapsCount())
-            return; //last map index, time 0, nothing to do
+    std::vector<BatchRange> batch(ranges.size());
 
-        //lets see when next map appears
-        i = demo->getMapId(mapIndex + 1);
+    try {
+        int passBegin = demo->getMessageCount();
 
-        //delete everything beginning with that map
-        demo->deleteMessage(i, demo->getMessageCount());
+        for (int r = 0; r < (int)ranges.size(); ++r) {
+            BatchRange& range = batch[r];
+            const CutRange& cutRange = ranges[r];
 
-        if (!demo->isMapRestart(mapIndex)) {
-            //check last few messages and remove mapChange sequence
-            int index = demo->getMessageCount() - 33;
-            if (index < 0)
-                index = 0;
+            assert(cutRange.beginTime >= 0 && cutRange.endTime >= 0);
 
-            Message* msg;
-            bool found = false;
-            while (index < demo->getMessageCount()) {
-                msg = demo->getMessage(index);
-                for (int j = 0; j < msg->getInstructionsCount(); ++j) {
-                    if (msg->getInstruction(j)->getType() == INSTR_MAPCHANGE) {
-                        found = true;
-                        break;
-                    }
-                }
+            range.range = &cutRange;
+            range.state = BatchRange::PENDING;
+            range.isRestart = demo->isMapRestart(cutRange.beginMapIndex);
+            range.rebuild = cutRange.beginTime != 0 || range.isRestart;
 
-                if (found)
-                    break;
+            if (range.rebuild) {
+                range.beginId = demo->getMapId(getGamestateMap(demo, cutRange.beginMapIndex));
+                range.beginLimit = getNextMapId(demo, cutRange.beginMapIndex);
 
-                ++index;
+                range.firstId = findBegin(demo, cutRange.beginTime, cutRange.beginMapIndex);
+
+                if (range.firstId < passBegin)
+                    passBegin = range.firstId;
+            }
+            else {
+                range.beginId = demo->getMapId(cutRange.beginMapIndex);
+
+                if (range.beginId < passBegin)
+                    passBegin = range.beginId;
             }
 
-            if (found)
-                demo->deleteMessage(index, demo->getMessageCount());
+            range.end = findEnd(demo, cutRange.endTime, cutRange.endMapIndex);
         }
 
-        return;
-    }
+        int finished = 0;
 
-    int nextMapMessageindex;
+        for (int i = passBegin; i < demo->getMessageCount() && finished < (int)batch.size(); ++i) {
+            for (int r = 0; r < (int)batch.size(); ++r) {
+                BatchRange& range = batch[r];
 
-    if (mapIndex < demo->getMapsCount() - 1)
-        nextMapMessageindex = demo->getMapId(mapIndex + 1);
-    else
-        nextMapMessageindex = demo->getMessageCount();
+                if (range.state == BatchRange::FINISHED)
+                    continue;
 
-    i = demo->getMapId(mapIndex);
-    while (i < nextMapMessageindex) {
-        demo->loadMessage(i);
+                if (i >= range.end) {
+                    if (range.state == BatchRange::PENDING)
+                        throw DemoException("starting time was not found");
 
-        snapTime = getSnapshotTime(demo->getMessage(i));
-        if ((snapTime != -1) && ((snapTime - starttime) >= time))
-            break;
+                    closeOutput(range);
+                    ++finished;
+                    continue;
+                }
 
-        //TO DO: check some Changed variable instead
-        if (i > 33) //these messages could be delta changed
-            demo->unloadMessage(i);
+                if (range.state == BatchRange::PENDING) {
+                    if (!range.rebuild) {
+                        if (i != range.beginId)
+                            continue;
 
-        ++i;
-    }
+                        openOutput(range);
+                    }
+                    else {
+                        if (i != range.firstId)
+                            continue;
+
+                        openOutput(range);
+
+                        //gamestate is rebuilt from tracker, nothing is replayed
+                        Message* message = copyGamestateMessage(demo, range.beginId,
+                            range.isRestart ? i : i - 1);
+                        try {
+                            range.firstMessage = writeStart(demo, i, message, *range.output);
+                        }
+                        catch (std::exception&) {
+                            delete message;
+                            throw;
+                        }
+                        delete message;
+
+                        range.bases = new DeltaBases();
+                        range.bases->add(i, getFirstSnapshot(range.firstMessage));
+
+                        range.windowEnd = i + 33;
+                        if (range.windowEnd > range.beginLimit)
+                            range.windowEnd = range.beginLimit;
+                        continue;
+                    }
+                }
+
+                if (range.firstMessage && i < range.windowEnd)
+                    writeFollowing(demo, i, range.firstId, *range.bases, *range.output);
+                else
+                    demo->saveMessage(i, *range.output);
+            }
+        }
 
-    if (i < nextMapMessageindex)
-        demo->unloadMessage(i);
+        for (int r = 0; r < (int)batch.size(); ++r) {
+            if (batch[r].state == BatchRange::PENDING)
+                throw DemoException("starting time was not found");
+        }
+    }
+    catch (std::exception&) {
+        clearBatch(batch);
+        throw;
+    }
 
-    demo->deleteMessage(i, demo->getMessageCount());
+    clearBatch(batch);
 }
@@ -5,16 +5,68 @@
 
 using namespace DemoJKA;
 
-Snapshot* getFirstSnapshot(Message* message);
-int getStartTime(Demo* demo, int mapIndex);
-int getSnapshotTime(Message* message);
+class DeltaBases;
+
+/*
+One range of batch cut, see Cutter::cut for meaning of the values.
+*/
+struct CutRange {
+    int         beginMapIndex;
+    int         beginTime;
+    int         endMapIndex;
+    int         endTime;
+    std::string filename;
+
+    CutRange(int beginMapIndex, int beginTime, int endMapIndex, int endTime,
+        const std::string& filename)
+        : beginMapIndex(beginMapIndex), beginTime(beginTime),
+        endMapIndex(endMapIndex), endTime(endTime), filename(filename)
+    {};
+};
 
 class Cutter {
+private:
+    static Message* copyMessage(Demo* demo, int id);
+    static Message* copyGamestateMessage(Demo* demo, int id, int configstringsId);
+    static int findMessage(Demo* demo, int id, int seqNumber);
+    static void uncompressSnapshot(Demo* demo, int id, Snapshot* snapshot);
+    static int findBegin(Demo* demo, int time, int mapIndex);
+    static int findEnd(Demo* demo, int time, int mapIndex);
+
+    static Message* writeStart(Demo* demo, int id, Message* gamestateMessage, std::ostream& os);
+    static void writeFollowing(Demo* demo, int id, int firstId, DeltaBases& bases,
+        std::ostream& os);
 
 public:
-    static void	cutFromTime(Demo* demo, int time, int mapIndex);
-    static void	cutToTime(Demo* demo, int time, int mapIndex);
+    /*
+    Writes part of the demo to output stream. Demo must be analysed and it isnt
+    modified, so it can be cut again. Source is read only once, only the new
+    gamestate (configstrings are taken from demo tracker) and first snapshots
+    (which are delta compressed against messages before cut) are rebuilt, rest
+    of the messages is copied as it is.
+
+    beginMapIndex, beginTime - where output begins, time is in ms from
+    the map start, 0 means beginning of the map
+    endMapIndex, endTime - where output ends, 0 means end of the map
+    listener - optional, gets messages written out of total, cutting can be
+    cancelled by it (output is left incomplete then)
+    */
+    static void cut(Demo* demo, int beginMapIndex, int beginTime,
+        int endMapIndex, int endTime, std::ostream& os, ProgressListener* listener = 0);
+
+    /*
+    Same as above, output is written to file with given name. Returns false
+    when output file cant be opened.
+    */
+    static bool cut(Demo* demo, int beginMapIndex, int beginTime,
+        int endMapIndex, int endTime, const char* filename, ProgressListener* listener = 0);
 
+    /*
+    Cuts all ranges in one sequential pass over the demo, ranges can overlap.
+    Output file of range is opened when the range begins and closed when
+    it ends.
+    */
+    static void cut(Demo* demo, const std::vector<CutRange>& ranges);
 };
 
-#endif
\ No newline at end of file
+#endif
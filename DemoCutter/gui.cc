@@ -1,10 +1,258 @@
 #include "gui.h"
 #include <time.h>
 
+TimelineWidget::TimelineWidget(QWidget* parent)
+    : QWidget(parent), timeline(0), mapId(0), hoverSecond(-1) {
+    setMouseTracking(true);
+}
+
+void TimelineWidget::setTimeline(const DemoJKA::Timeline* timeline, int mapId) {
+    this->timeline = timeline;
+    this->mapId = mapId;
+    hoverSecond = -1;
+    update();
+}
+
+int TimelineWidget::getSecond(int x) const {
+    if (!timeline || mapId >= timeline->getMapsCount())
+        return -1;
+
+    int count = timeline->getEntriesCount(mapId);
+    if (!count || width() <= 0)
+        return -1;
+
+    int second = x * count / width();
+    if (second < 0)
+        return 0;
+    if (second >= count)
+        return count - 1;
+
+    return second;
+}
+
+void TimelineWidget::paintEvent(QPaintEvent* /*event*/) {
+    QPainter painter(this);
+    int w = width();
+    int h = height();
+
+    painter.fillRect(0, 0, w, h, QColor(40, 40, 40));
+
+    if (!timeline || mapId >= timeline->getMapsCount())
+        return;
+
+    int count = timeline->getEntriesCount(mapId);
+    if (!count)
+        return;
+
+    //health scale, overcharged health still fits
+    int maxHealth = 100;
+    for (int i = 0; i < count; ++i)
+        if (timeline->getEntry(mapId, i).health > maxHealth)
+            maxHealth = timeline->getEntry(mapId, i).health;
+
+    for (int i = 0; i < count; ++i) {
+        const DemoJKA::TimelineEntry& entry = timeline->getEntry(mapId, i);
+        int x1 = i * w / count;
+        int x2 = (i + 1) * w / count;
+
+        if (entry.health > 0) {
+            int y = h - entry.health * (h - 2) / maxHealth;
+            painter.fillRect(x1, y, (x2 > x1) ? x2 - x1 : 1, h - y, QColor(70, 110, 160));
+        }
+
+        if (entry.markers & DemoJKA::TIMELINE_KILL) {
+            painter.setPen(QColor(80, 220, 80));
+            painter.drawLine(x1, 0, x1, h / 2);
+        }
+
+        if (entry.markers & DemoJKA::TIMELINE_DEATH) {
+            painter.setPen(QColor(230, 60, 60));
+            painter.drawLine(x1, h / 2, x1, h);
+        }
+    }
+
+    if (hoverSecond >= 0) {
+        int x = hoverSecond * w / count;
+        painter.setPen(QColor(255, 255, 255));
+        painter.drawLine(x, 0, x, h);
+    }
+}
+
+void TimelineWidget::mouseMoveEvent(QMouseEvent* event) {
+    int second = getSecond((int)event->position().x());
+    if (second == hoverSecond)
+        return;
+
+    hoverSecond = second;
+    update();
+
+    if (second < 0)
+        return;
+
+    const DemoJKA::TimelineEntry& entry = timeline->getEntry(mapId, second);
+
+    //entries begin at the first snapshot of the map
+    second += timeline->getFirstSecond(mapId);
+
+    QString s = QString::number(second / 60) + ":" +
+        (second % 60 < 10 ? "0" : "") + QString::number(second % 60) +
+        "  health " + QString::number(entry.health) +
+        "  (" + QString::number((int)entry.origin[0]) +
+        ", " + QString::number((int)entry.origin[1]) +
+        ", " + QString::number((int)entry.origin[2]) + ")";
+
+    if (entry.markers & DemoJKA::TIMELINE_KILL)
+        s += "  kill";
+    if (entry.markers & DemoJKA::TIMELINE_DEATH)
+        s += "  death";
+
+    QToolTip::showText(event->globalPosition().toPoint(), s, this);
+}
+
+void TimelineWidget::mousePressEvent(QMouseEvent* event) {
+    int second = getSecond((int)event->position().x());
+    if (second < 0)
+        return;
+
+    second += timeline->getFirstSecond(mapId);
+
+    if (event->button() == Qt::LeftButton)
+        emit timeSelected(mapId, second, false);
+    else if (event->button() == Qt::RightButton)
+        emit timeSelected(mapId, second, true);
+}
+
+void TimelineWidget::leaveEvent(QEvent* /*event*/) {
+    hoverSecond = -1;
+    update();
+}
+
+DemoWorker::DemoWorker(QObject* parent)
+    : QThread(parent), task(TASK_NONE), cancelled(false), demo(0), timeline(0),
+    beginMapIndex(0), beginTime(0), endMapIndex(0), endTime(0) {
+}
+
+void DemoWorker::load(DemoJKA::Demo* demo, DemoJKA::Timeline* timeline, const QString& filename) {
+    this->demo = demo;
+    this->timeline = timeline;
+    this->filename = filename;
+    task = TASK_LOAD;
+    cancelled = false;
+
+    //taskFinished is emitted from run(), thread can still be ending
+    wait();
+    assert(!isRunning());
+    start();
+}
+
+void DemoWorker::cut(DemoJKA::Demo* demo, int beginMapIndex, int beginTime,
+    int endMapIndex, int endTime, const QString& filename) {
+    this->demo = demo;
+    this->filename = filename;
+    this->beginMapIndex = beginMapIndex;
+    this->beginTime = beginTime;
+    this->endMapIndex = endMapIndex;
+    this->endTime = endTime;
+    task = TASK_CUT;
+    cancelled = false;
+
+    wait();
+    assert(!isRunning());
+    start();
+}
+
+void DemoWorker::cancel() {
+    cancelled = true;
+}
+
+bool DemoWorker::progress(int done, int total) {
+    emit progressChanged(done, total);
+    return !cancelled;
+}
+
+void DemoWorker::mapAnalysed(int mapId, const std::string& mapName, bool /*isMapRestart*/,
+    int startTime, int endTime) {
+    emit mapFound(mapId, QString(mapName.c_str()), startTime, endTime);
+}
+
+void DemoWorker::run() {
+    QElapsedTimer timer;
+    timer.start();
+
+    bool ok = true;
+    QString message;
+
+    try {
+        if (task == TASK_LOAD) {
+            if (!demo->open(filename.toLatin1())) {
+                ok = false;
+                message = "Input demo cant be opened.";
+            }
+            else {
+                //analyse to find map starts
+                demo->analyse(this);
+
+                //timeline needs full decoding, so it is cached next to the demo,
+                //missing or unwritable cache only means building next time again
+                std::string cache = DemoJKA::Timeline::getCacheFilename(filename.toLatin1().constData());
+                if (!timeline->load(cache.c_str(), demo)) {
+                    timeline->build(demo, this);
+                    timeline->save(cache.c_str(), demo);
+                }
+            }
+        }
+        else if (task == TASK_CUT) {
+            //input demo stays untouched, so it can be cut again
+            if (!Cutter::cut(demo, beginMapIndex, beginTime, endMapIndex, endTime,
+                filename.toLatin1(), this)) {
+                ok = false;
+                message = "Output file cant be opened.";
+            }
+        }
+    }
+    catch (std::exception& e) {
+        ok = false;
+        message = cancelled ? QString("Cancelled.") : QString(e.what());
+
+        //dont leave incomplete output behind
+        if (task == TASK_CUT)
+            QFile::remove(filename);
+    }
+
+    if (ok)
+        message = QString::number(timer.elapsed() / 1000.0) + "s";
+
+    emit taskFinished(task, ok, message);
+}
+
 MainWindow::MainWindow(QMainWindow* parent)
-    : QMainWindow(parent) {
+    : QMainWindow(parent), inputLoaded(false) {
     ui.setupUi(this);
     setAcceptDrops(true);
+
+    timelineWidget = new TimelineWidget(ui.groupBoxStep2);
+    timelineWidget->setObjectName(QString::fromUtf8("timelineWidget"));
+    timelineWidget->setGeometry(QRect(10, 92, 361, 50));
+    timelineWidget->setToolTip("Left click sets begin, right click sets end");
+    connect(timelineWidget, SIGNAL(timeSelected(int, int, bool)), this, SLOT(onTimeSelected(int, int, bool)));
+
+    //signals come from worker thread, so they are queued
+    connect(&worker, SIGNAL(progressChanged(int, int)), this, SLOT(onProgressChanged(int, int)));
+    connect(&worker, SIGNAL(mapFound(int, QString, int, int)), this, SLOT(onMapFound(int, QString, int, int)));
+    connect(&worker, SIGNAL(taskFinished(int, bool, QString)), this, SLOT(onTaskFinished(int, bool, QString)));
+    connect(&worker, SIGNAL(finished()), this, SLOT(onWorkerFinished()));
+}
+
+void MainWindow::closeEvent(QCloseEvent* event) {
+    worker.cancel();
+    worker.wait();
+    QMainWindow::closeEvent(event);
+}
+
+void MainWindow::setBusy(bool busy) {
+    ui.progressBar->setVisible(busy);
+    ui.cancelButton->setVisible(busy);
+    ui.progressBar->setValue(0);
 }
 
 void MainWindow::setDisabledStep2(bool disabled) {
@@ -24,6 +272,9 @@ void MainWindow::clearStep2() {
 }
 
 void MainWindow::clearStep3() {
+    timelineWidget->setTimeline(0, 0);
+    inputTimeline.clear();
+
     ui.beginMap->clear();
     ui.endMap->clear();
 
@@ -51,58 +302,120 @@ void MainWindow::on_inputFileButton_clicked() {
     if (s.isEmpty())
         return;
 
-    ui.inputFileName->setText(s);
+    if (worker.isRunning()) {
+        //demo is in use, new one is opened when worker finishes,
+        //loading of the old one isnt needed anymore
+        queuedFile = s;
+        if (worker.getTask() == DemoWorker::TASK_LOAD)
+            worker.cancel();
+
+        ui.statusbar->showMessage("Queued: " + s);
+        return;
+    }
+
+    startLoad(s);
+}
+
+void MainWindow::startLoad(const QString& filename) {
+    ui.inputFileName->setText(filename);
     clearStep3();
 
-    //cant change parameters after doing cutting, because demo is messed up
-    //lets implement this later
+    //nothing to cut until new demo is loaded
+    inputLoaded = false;
     setDisabledStep2(true);
     setDisabledStep3(true);
 
-    try {
-        clock_t realTimeBegin, realTimeEnd;
-        realTimeBegin = clock();
+    setBusy(true);
+    ui.statusbar->showMessage("Analysing...");
+    worker.load(&inputDemo, &inputTimeline, filename);
+}
 
-        //open demo
-        ui.statusbar->showMessage("Loading demo...");
-        inputDemo.open(s.toLatin1());
+void MainWindow::on_cancelButton_clicked() {
+    worker.cancel();
+    queuedFile.clear();
+}
 
-        //analyse to find map starts
-        ui.statusbar->showMessage("Analysing...");
-        inputDemo.analyse();
+void MainWindow::onProgressChanged(int done, int total) {
+    ui.progressBar->setMaximum(total);
+    ui.progressBar->setValue(done);
+}
 
-        realTimeEnd = clock();
-        ui.statusbar->showMessage("Loaded. (" + QString::number(((float)(realTimeEnd - realTimeBegin) / CLOCKS_PER_SEC)) + "s)");
+void MainWindow::onMapFound(int mapId, QString mapName, int startTime, int endTime) {
+    //maps are shown while analysis still runs
+    QString s = QString::number(mapId) +
+        ": " +
+        mapName +
+        " (" +
+        formatTime(startTime) +
+        " - " +
+        formatTime(endTime) +
+        ")";
+
+    ui.beginMap->addItem(s);
+    ui.endMap->addItem(s);
+}
 
+void MainWindow::onTaskFinished(int task, bool ok, QString message) {
+    setBusy(false);
+
+    if (task == DemoWorker::TASK_LOAD) {
+        if (!ok) {
+            clearStep3();
+            ui.statusbar->showMessage("ERROR: " + message);
+        }
+        else if (inputDemo.getMapsCount() == 0) {
+            ui.statusbar->showMessage("Failed to load map list.");
+        }
+        else {
+            inputLoaded = true;
+            timelineWidget->setTimeline(&inputTimeline, ui.beginMap->currentIndex());
+            ui.statusbar->showMessage("Loaded. (" + message + ")");
+        }
     }
-    catch (std::exception& e) {
-        ui.statusbar->showMessage("ERROR: " + QString(e.what()));
-        return;
+    else {
+        if (ok)
+            ui.statusbar->showMessage("Done! (" + message + ")");
+        else
+            ui.statusbar->showMessage("ERROR: " + message);
     }
 
-    if (inputDemo.getMapsCount() == 0)
-        ui.statusbar->showMessage("Failed to load map list.");
+    if (task == DemoWorker::TASK_LOAD && inputLoaded)
+        clearStep2();
 
-    for (int i = 0; i < inputDemo.getMapsCount(); ++i) {
-        QString mapName = (inputDemo.getMapName(i)).c_str();
-        QString s = QString::number(i) +
-            ": " +
-            mapName +
-            " (" +
-            formatTime(inputDemo.getMapStartTime(i)) +
-            " - " +
-            formatTime(inputDemo.getMapEndTime(i)) +
-            ")";
+    if (inputLoaded) {
+        setDisabledStep2(false);
+        setDisabledStep3(false);
+    }
+}
 
-        ui.beginMap->addItem(s);
-        ui.endMap->addItem(s);
+void MainWindow::onWorkerFinished() {
+    //thread has ended, so it can be started again
+    if (!queuedFile.isEmpty()) {
+        QString s = queuedFile;
+        queuedFile.clear();
+        startLoad(s);
     }
+}
 
-    clearStep2();
-    setDisabledStep2(false);
+void MainWindow::on_beginMap_currentIndexChanged(int index) {
+    //timeline is filled only when whole loading is done
+    if (inputLoaded && index >= 0)
+        timelineWidget->setTimeline(&inputTimeline, index);
+}
 
-    //disable step3 - in case someone changed input file
-    setDisabledStep3(false);
+void MainWindow::onTimeSelected(int mapId, int second, bool isEnd) {
+    if (!inputLoaded || worker.isRunning())
+        return;
+
+    QString s = formatTime(second) + ".0";
+
+    if (isEnd) {
+        ui.endMap->setCurrentIndex(mapId);
+        ui.endTime->setText(s);
+    }
+    else {
+        ui.beginTime->setText(s);
+    }
 }
 
 void MainWindow::on_outputFileButton_clicked() {
@@ -169,35 +482,13 @@ void MainWindow::on_outputFileButton_clicked() {
     if (s.isEmpty())
         return;
 
-    //cant change parameters after doing cutting, because demo is messed up
-    //lets implement this later
-    setDisabledStep2(true);
-    setDisabledStep3(true);
-
     ui.outputFileName->setText(s);
 
-    clock_t realTimeBegin, realTimeEnd;
-    realTimeBegin = clock();
-
-    try {
-        //lets cut off end
-        ui.statusbar->showMessage("Cutting off end...");
-        Cutter::cutToTime(&inputDemo, endTimeMs, endMapIndex);
-
-        //and now cut off beginning
-        ui.statusbar->showMessage("Cutting off beginning...");
-        Cutter::cutFromTime(&inputDemo, beginTimeMs, beginMapIndex);
-
-        ui.statusbar->showMessage("Saving Output Demo...");
-        inputDemo.save(ui.outputFileName->text().toLatin1());
-
-    }
-    catch (std::exception& e) {
-        ui.statusbar->showMessage("ERROR: " + QString(e.what()));
-        return;
-    }
-
-    realTimeEnd = clock();
+    //demo is used by worker until cutting is done
+    setDisabledStep2(true);
+    setDisabledStep3(true);
 
-    ui.statusbar->showMessage("Done! (" + QString::number(((float)(realTimeEnd - realTimeBegin) / CLOCKS_PER_SEC)) + "s)");
+    setBusy(true);
+    ui.statusbar->showMessage("Cutting...");
+    worker.cut(&inputDemo, beginMapIndex, beginTimeMs, endMapIndex, endTimeMs, s);
 }
@@ -4,8 +4,95 @@
 
 //! [0]
 #include "gui_ui.h"
+#include <atomic>
 //! [0]
 
+/*
+Shows timeline of one map: health of the recorded player, kills (green) and
+deaths (red). Data come from DemoJKA::Timeline only, nothing is decoded while
+scrubbing. Left click picks begin time, right click picks end time.
+*/
+class TimelineWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    TimelineWidget(QWidget* parent = 0);
+
+    //timeline must stay valid while it is shown, 0 clears the widget
+    void setTimeline(const DemoJKA::Timeline* timeline, int mapId);
+
+signals:
+    void timeSelected(int mapId, int second, bool isEnd);
+
+protected:
+    void paintEvent(QPaintEvent* event);
+    void mouseMoveEvent(QMouseEvent* event);
+    void mousePressEvent(QMouseEvent* event);
+    void leaveEvent(QEvent* event);
+
+private:
+    const DemoJKA::Timeline*    timeline;
+    int                         mapId;
+    int                         hoverSecond;
+
+    int getSecond(int x) const;
+};
+
+/*
+Runs loading and cutting of the demo outside of UI thread. Progress,
+analysed maps and results are passed to the window by queued signals,
+demo must not be touched by window until taskFinished is received.
+*/
+class DemoWorker : public QThread, public DemoJKA::ProgressListener
+{
+    Q_OBJECT
+
+public:
+    enum {
+        TASK_NONE,
+        TASK_LOAD,
+        TASK_CUT
+    };
+
+    DemoWorker(QObject* parent = 0);
+
+    //timeline is built after analysis, or loaded from cache when there is one
+    void load(DemoJKA::Demo* demo, DemoJKA::Timeline* timeline, const QString& filename);
+    void cut(DemoJKA::Demo* demo, int beginMapIndex, int beginTime,
+        int endMapIndex, int endTime, const QString& filename);
+
+    //task stops at next progress report
+    void cancel();
+
+    int getTask() const { return task; };
+
+    //called from worker thread
+    bool progress(int done, int total);
+    void mapAnalysed(int mapId, const std::string& mapName, bool isMapRestart,
+        int startTime, int endTime);
+
+signals:
+    void progressChanged(int done, int total);
+    void mapFound(int mapId, QString mapName, int startTime, int endTime);
+    void taskFinished(int task, bool ok, QString message);
+
+protected:
+    void run();
+
+private:
+    int                 task;
+    std::atomic<bool>   cancelled;
+
+    DemoJKA::Demo*      demo;
+    DemoJKA::Timeline*  timeline;
+    QString             filename;
+    int                 beginMapIndex;
+    int                 beginTime;
+    int                 endMapIndex;
+    int                 endTime;
+};
+
 //! [1]
 class MainWindow : public QMainWindow
 {
@@ -14,14 +101,36 @@ class MainWindow : public QMainWindow
 public:
     MainWindow(QMainWindow* parent = 0);
 
+protected:
+    void closeEvent(QCloseEvent* event);
+
 private slots:
     void on_inputFileButton_clicked();
     void on_outputFileButton_clicked();
+    void on_cancelButton_clicked();
+
+    void onProgressChanged(int done, int total);
+    void onMapFound(int mapId, QString mapName, int startTime, int endTime);
+    void onTaskFinished(int task, bool ok, QString message);
+    void onWorkerFinished();
+
+    void onTimeSelected(int mapId, int second, bool isEnd);
+    void on_beginMap_currentIndexChanged(int index);
 
 private:
     Ui::MainWindow ui;
 
-    DemoJKA::Demo	inputDemo;
+    DemoJKA::Demo	    inputDemo;
+    DemoJKA::Timeline   inputTimeline;
+    bool                inputLoaded;
+
+    TimelineWidget*     timelineWidget;
+
+    DemoWorker      worker;
+    QString         queuedFile; //opened when worker thread finishes
+
+    void startLoad(const QString& filename);
+    void setBusy(bool busy);
 
     void setDisabledStep2(bool disabled);
     void setDisabledStep3(bool disabled);
@@ -33,4 +142,4 @@ private:
 };
 //! [1]
 
-#endif
\ No newline at end of file
+#endif
@@ -12,6 +12,7 @@
 #define GUI_UI_H
 
 #include "demo.h"
+#include "timeline.h"
 #include "cutter.h"
 
 #pragma comment(lib, "shcore.lib")
@@ -34,11 +35,22 @@ Q_IMPORT_PLUGIN(QWindowsIntegrationPlugin);
 #include <QtWidgets/QWidget>
 #include <QtWidgets/QFileDialog>
 #include <QtWidgets/QLabel>
+#include <QtWidgets/QProgressBar>
+#include <QtCore/QThread>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtGui/QCloseEvent>
+#include <QtGui/QMouseEvent>
+#include <QtGui/QPainter>
+#include <QtWidgets/QToolTip>
 
-#define VERSION "v0.9.12"
+#define VERSION "v0.9.15"
 
 /*
  
+v0.9.15 - timeline of selected map, click picks begin/end time
+v0.9.14 - loading and cutting runs in background with progress and cancel
+v0.9.13 - single pass cutting, demo can be cut repeatedly without reloading
 v0.9.12 - integrated with Qt6/Conan/Cmake
 v0.9.11 - relaxed checks to deal with delta from invalid frame
 v0.9.10 - extented minutes limit from 999 to 9999
@@ -84,13 +96,15 @@ public:
     QStatusBar* statusbar;
     QLabel* labelBegin;
     QLabel* labelEnd;
+    QProgressBar* progressBar;
+    QPushButton* cancelButton;
 
 
     void setupUi(QMainWindow* MainWindow)
     {
         if (MainWindow->objectName().isEmpty())
             MainWindow->setObjectName(QString::fromUtf8("MainWindow"));
-        MainWindow->setFixedSize(400, 246);
+        MainWindow->setFixedSize(400, 306);
 
         centralwidget = new QWidget(MainWindow);
         centralwidget->setObjectName(QString::fromUtf8("centralwidget"));
@@ -112,7 +126,7 @@ public:
         //Step2
         groupBoxStep2 = new QGroupBox(centralwidget);
         groupBoxStep2->setObjectName(QString::fromUtf8("groupBoxStep2"));
-        groupBoxStep2->setGeometry(QRect(10, 70, 381, 91));
+        groupBoxStep2->setGeometry(QRect(10, 70, 381, 151)); //timeline is added by MainWindow
 
         beginMap = new QComboBox(groupBoxStep2);
         beginMap->setObjectName(QString::fromUtf8("beginMap"));
@@ -152,7 +166,7 @@ public:
         //Step3
         groupBoxStep3 = new QGroupBox(centralwidget);
         groupBoxStep3->setObjectName(QString::fromUtf8("groupBoxStep3"));
-        groupBoxStep3->setGeometry(QRect(10, 170, 381, 51));
+        groupBoxStep3->setGeometry(QRect(10, 230, 381, 51));
 
         outputFileButton = new QPushButton(groupBoxStep3);
         outputFileButton->setObjectName(QString::fromUtf8("outputFileButton"));
@@ -178,6 +192,20 @@ public:
         statusbar->setObjectName(QString::fromUtf8("statusbar"));
         MainWindow->setStatusBar(statusbar);
 
+        //progress of running task, visible only while working
+        progressBar = new QProgressBar(statusbar);
+        progressBar->setObjectName(QString::fromUtf8("progressBar"));
+        progressBar->setFixedSize(100, 16);
+        progressBar->setTextVisible(false);
+        progressBar->setVisible(false);
+        statusbar->addPermanentWidget(progressBar);
+
+        cancelButton = new QPushButton(statusbar);
+        cancelButton->setObjectName(QString::fromUtf8("cancelButton"));
+        cancelButton->setFixedSize(60, 18);
+        cancelButton->setVisible(false);
+        statusbar->addPermanentWidget(cancelButton);
+
         retranslateUi(MainWindow);
 
         QMetaObject::connectSlotsByName(MainWindow);
@@ -193,6 +221,7 @@ public:
         outputFileButton->setText(QApplication::translate("MainWindow", "Cut!", 0));
         labelBegin->setText(QApplication::translate("MainWindow", "Begin:", 0));
         labelEnd->setText(QApplication::translate("MainWindow", "End:", 0));
+        cancelButton->setText(QApplication::translate("MainWindow", "Cancel", 0));
 
     } // retranslateUi
 
@@ -0,0 +1,97 @@
+#include "commandtracker.h"
+
+DEMO_NAMESPACE_START
+
+CommandTracker::CommandTracker() : lastSequence(0), started(false) {
+}
+
+void CommandTracker::reset() {
+    received.reset();
+    lastSequence = 0;
+    started = false;
+}
+
+void CommandTracker::reset(const Gamestate* gamestate) {
+    received.set();
+    lastSequence = gamestate->getCommandSequence();
+    started = true;
+}
+
+bool CommandTracker::isReceived(int sequence) const {
+    if (!started || sequence > lastSequence)
+        return false;
+
+    if (sequence <= lastSequence - MAX_RELIABLE_COMMANDS)
+        return true;
+
+    return received[sequence & (MAX_RELIABLE_COMMANDS - 1)];
+}
+
+bool CommandTracker::receive(int sequence) {
+    if (isReceived(sequence))
+        return false;
+
+    if (!started) {
+        received.reset();
+        lastSequence = sequence;
+        started = true;
+    }
+    else if (sequence > lastSequence) {
+        //commands between are in the window now, but werent received yet
+        if (sequence - lastSequence >= MAX_RELIABLE_COMMANDS)
+            received.reset();
+        else
+            for (int i = lastSequence + 1; i < sequence; ++i)
+                received.reset(i & (MAX_RELIABLE_COMMANDS - 1));
+
+        lastSequence = sequence;
+    }
+
+    received.set(sequence & (MAX_RELIABLE_COMMANDS - 1));
+    return true;
+}
+
+int CommandTracker::removeDuplicates(Message* message) {
+    int count = 0;
+
+    for (int i = 0; i < message->getInstructionsCount(); ++i) {
+        Instruction* instruction = message->getInstruction(i);
+
+        if (instruction->getType() == INSTR_GAMESTATE) {
+            reset(instruction->getGamestate());
+        }
+        else if (instruction->getType() == INSTR_SERVERCOMMAND
+            && !receive(instruction->getServerCommand()->getSequenceNumber())) {
+            message->deleteInstruction(i);
+            --i;
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+int CommandTracker::clearSuperseded(Message* message) {
+    std::map<int, ServerCommand*> last; //last cs command of configstring
+    int count = 0;
+
+    for (int i = 0; i < message->getInstructionsCount(); ++i) {
+        ServerCommand* command = message->getInstruction(i)->getServerCommand();
+        int index;
+
+        if (!command || command->getConfigstring(&index, 0) != CONFIGSTRING_SET)
+            continue;
+
+        std::map<int, ServerCommand*>::iterator it = last.find(index);
+        if (it != last.end()) {
+            it->second->setCommand("");
+            ++count;
+        }
+
+        last[index] = command;
+    }
+
+    return count;
+}
+
+DEMO_NAMESPACE_END
@@ -0,0 +1,54 @@
+#ifndef COMMANDTRACKER_H
+#define COMMANDTRACKER_H
+
+#include "message.h"
+
+DEMO_NAMESPACE_START
+
+/*
+Keeps track of reliable server commands received while demo is read in
+order, so commands which server sent again (until client acknowledged them)
+are found. Client keeps only last MAX_RELIABLE_COMMANDS commands, so server
+never resends anything older than that behind the last received one. Commands
+of the window are remembered in bitset indexed by sequence number, older
+ones are taken as received.
+
+Gamestate starts new sequence, commands up to its command sequence number
+are taken as received (client ignores them too).
+*/
+class CommandTracker
+{
+private:
+    std::bitset<MAX_RELIABLE_COMMANDS>  received;
+    int                                 lastSequence;   //highest received
+    bool                                started;
+
+public:
+    CommandTracker();
+
+    void reset();
+    void reset(const Gamestate* gamestate);
+
+    bool isReceived(int sequence) const;
+
+    //returns false when command was already received
+    bool receive(int sequence);
+
+    /*
+    Deletes server commands of message which were already received, gamestates
+    of message reset tracker. Returns number of deleted commands.
+    */
+    int removeDuplicates(Message* message);
+
+    /*
+    Clears cs commands of message which are overwritten by later cs command
+    of the same configstring in that message, client executes all of them
+    at once. Commands are only emptied, so sequence numbers stay complete.
+    Returns number of cleared commands.
+    */
+    static int clearSuperseded(Message* message);
+};
+
+DEMO_NAMESPACE_END
+
+#endif
@@ -0,0 +1,138 @@
+#include "configstrings.h"
+
+DEMO_NAMESPACE_START
+
+ConfigstringTracker::ConfigstringTracker(int checkpointInterval)
+    : checkpointInterval(checkpointInterval)
+{
+    assert(checkpointInterval > 0);
+    clear();
+}
+
+void ConfigstringTracker::clear() {
+    changes.clear();
+    checkpoints.clear();
+    current.clear();
+    lastMessageId = -1;
+    bigIndex = -1;
+    bigValue.clear();
+}
+
+void ConfigstringTracker::addChange(int messageId, int index, const std::string& value) {
+    changes.push_back(Change(messageId, index, value));
+    current[index] = value;
+}
+
+void ConfigstringTracker::addCheckpoint(int messageId) {
+    checkpoints.push_back(Checkpoint());
+    checkpoints.back().messageId = messageId;
+    checkpoints.back().change = (int)changes.size();
+    checkpoints.back().strings = current;
+}
+
+/*
+Returns index of the last checkpoint which is not after the message, -1 if there is none.
+*/
+int ConfigstringTracker::findCheckpoint(int messageId) const {
+    int low = 0;
+    int high = (int)checkpoints.size();
+
+    while (low < high) {
+        int middle = (low + high) / 2;
+
+        if (checkpoints[middle].messageId <= messageId)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low - 1;
+}
+
+void ConfigstringTracker::addMessage(int messageId, Message* message) {
+    if (!message || messageId <= lastMessageId)
+        return;
+
+    lastMessageId = messageId;
+
+    int index;
+    std::string value;
+
+    for (int i = 0; i < message->getInstructionsCount(); ++i) {
+        Instruction* instr = message->getInstruction(i);
+
+        if (instr->getType() == INSTR_GAMESTATE) {
+            //new map, all configstrings are replaced
+            current = instr->getGamestate()->getConfigstrings();
+            bigIndex = -1;
+            bigValue.clear();
+            addCheckpoint(messageId);
+        }
+        else if (instr->getType() == INSTR_SERVERCOMMAND) {
+            switch (instr->getServerCommand()->getConfigstring(&index, &value)) {
+            case CONFIGSTRING_SET:
+                addChange(messageId, index, value);
+                break;
+            case CONFIGSTRING_BIG_BEGIN:
+                bigIndex = index;
+                bigValue = value;
+                break;
+            case CONFIGSTRING_BIG_PART:
+                if (index == bigIndex)
+                    bigValue += value;
+                break;
+            case CONFIGSTRING_BIG_END:
+                if (index == bigIndex)
+                    addChange(messageId, index, bigValue + value);
+                bigIndex = -1;
+                bigValue.clear();
+                break;
+            }
+        }
+    }
+
+    int lastChange = checkpoints.empty() ? 0 : checkpoints.back().change;
+    if ((int)changes.size() - lastChange >= checkpointInterval)
+        addCheckpoint(messageId);
+}
+
+void ConfigstringTracker::getConfigstrings(int messageId, stringmap& strings) const {
+    int checkpoint = findCheckpoint(messageId);
+    int i = 0;
+
+    if (checkpoint >= 0) {
+        strings = checkpoints[checkpoint].strings;
+        i = checkpoints[checkpoint].change;
+    }
+    else {
+        strings.clear();
+    }
+
+    for (; i < (int)changes.size() && changes[i].messageId <= messageId; ++i)
+        strings[changes[i].index] = changes[i].value;
+}
+
+std::string ConfigstringTracker::getConfigstring(int messageId, int index) const {
+    int checkpoint = findCheckpoint(messageId);
+    int i = (checkpoint >= 0) ? checkpoints[checkpoint].change : 0;
+    int found = -1;
+
+    //last change of the configstring wins
+    for (; i < (int)changes.size() && changes[i].messageId <= messageId; ++i) {
+        if (changes[i].index == index)
+            found = i;
+    }
+
+    if (found != -1)
+        return changes[found].value;
+
+    if (checkpoint >= 0) {
+        stringmap::const_iterator it = checkpoints[checkpoint].strings.find(index);
+        if (it != checkpoints[checkpoint].strings.end())
+            return it->second;
+    }
+
+    return "";
+}
+
+DEMO_NAMESPACE_END
@@ -0,0 +1,90 @@
+#ifndef CONFIGSTRINGS_H
+#define CONFIGSTRINGS_H
+
+#include "message.h"
+
+DEMO_NAMESPACE_START
+
+/*
+Keeps history of configstrings through the demo, so full configstring set
+valid at any message can be rebuilt without replaying all server commands
+from the map start.
+
+Gamestates and configstring commands (cs, bcs0/1/2) are recorded to change
+log as messages are added. Every few changes whole set is stored as checkpoint,
+query starts from the nearest checkpoint before the message and applies only
+changes logged after it. Demo fills tracker during analyse().
+*/
+class ConfigstringTracker
+{
+public:
+    typedef std::map<int, std::string> stringmap;
+
+private:
+    struct Change {
+        int         messageId;
+        int         index;
+        std::string value;
+
+        Change(int messageId, int index, const std::string& value)
+            : messageId(messageId), index(index), value(value)
+        {};
+    };
+
+    //full set valid after all changes before change
+    struct Checkpoint {
+        int         messageId;
+        int         change;
+        stringmap   strings;
+    };
+
+    std::vector<Change>     changes;
+    std::vector<Checkpoint> checkpoints;
+    stringmap               current;
+    int                     lastMessageId;
+    int                     checkpointInterval;
+
+    //big configstring being assembled from bcs commands
+    int                     bigIndex;
+    std::string             bigValue;
+
+    void addChange(int messageId, int index, const std::string& value);
+    void addCheckpoint(int messageId);
+    int findCheckpoint(int messageId) const;
+
+public:
+    /*
+    checkpointInterval - number of changes between checkpoints
+    */
+    ConfigstringTracker(int checkpointInterval = 256);
+
+    void clear();
+
+    /*
+    Records gamestate and configstring commands of the message. Messages must be
+    added in order, message which is not after the last added one is ignored, so
+    reloaded message can be added again.
+    */
+    void addMessage(int messageId, Message* message);
+
+    /*
+    Returns id of the last added message, -1 when nothing was added.
+    */
+    int getLastMessageId() const { return lastMessageId; };
+
+    /*
+    Gives full configstring set valid after message messageId (its commands are
+    applied).
+    */
+    void getConfigstrings(int messageId, stringmap& strings) const;
+
+    /*
+    Gives single configstring valid after message messageId, empty string when
+    it isnt set.
+    */
+    std::string getConfigstring(int messageId, int index) const;
+};
+
+DEMO_NAMESPACE_END
+
+#endif
@@ -7,10 +7,13 @@
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <bitset>
 #include <iostream> 
 #include <algorithm>
 #include <exception>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 
 #define DEMO_NAMESPACE_START namespace DemoJKA{
 #define DEMO_NAMESPACE_END };
@@ -24,8 +27,13 @@
 #define     FLOAT_INT_BITS      13
 #define     FLOAT_INT_BIAS      (1<<(FLOAT_INT_BITS-1))
 #define     MAX_CONFIGSTRINGS   1700
+#define     CS_LEVEL_START_TIME 21  //server time of map start
 #define     GENTITYNUM_BITS     10
 #define     MAX_GENTITIES       (1<<GENTITYNUM_BITS)
+#define     PACKET_BACKUP       32  //number of old messages that can be delta referenced
+#define     PACKET_MASK         (PACKET_BACKUP-1)
+#define     MAX_PARSE_ENTITIES  2048    //entities of last snapshots client keeps, delta base can be at most MAX_PARSE_ENTITIES-128 entities back
+#define     MAX_RELIABLE_COMMANDS   128 //number of server commands client keeps
 
 enum {
     SIZE_FLOAT = 0,
@@ -53,9 +61,26 @@ enum
     svc_EOF
 };
 
+//how deep snapshots are decoded, everything before snapshot
+//in the message (server commands, gamestate) is always decoded,
+//except for DECODE_COMMANDS and DECODE_GAMESTATE, which skip snapshots
+enum {
+    DECODE_COMMANDS = -2,   //only server commands, stop at snapshot or gamestate
+    DECODE_GAMESTATE,       //server commands and gamestates, stop at snapshot
+    DECODE_HEADER = 0,  //stop after snapshot header (server time, delta number, flags)
+    DECODE_PLAYERSTATE, //stop after playerstate (and vehicle state)
+    DECODE_FULL,        //whole message
+};
+
 class DemoException : public std::exception {
+private:
+    std::string message;
+
 public:
-    DemoException(const char* s) : std::exception(s) {};
+    DemoException(const char* s) : message(s) {};
+    ~DemoException() throw() {};
+
+    const char* what() const throw() { return message.c_str(); };
 };
 
 typedef unsigned char byte;
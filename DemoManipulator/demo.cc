@@ -3,23 +3,59 @@
 
 DEMO_NAMESPACE_START
 
+enum {
+    //lower two bits of index flags hold vehicle status
+    INDEX_VEHICLE_MASK = 3,
+    //message has snapshot, its server time is in index
+    INDEX_SNAPSHOT = 4,
+};
+
 class DemoImpl {
 public:
-    struct DemoRef { //12 bytes
-        int      offset;
-        Message* message;
-        int      vehicleStatus;
+    /*
+    Message index kept as struct of arrays. Scanning one column
+    (offsets while saving, sequence numbers while resolving deltas)
+    touches only that column and entry stays 17 bytes (+ pointer to
+    loaded message), offsets are 64-bit so demos over 2GB work. Index
+    isnt changed after opening, edits are kept over it (see Piece).
+    */
+    struct MessageIndex {
+        std::vector<std::streamoff> offsets;
+        std::vector<int>            seqNumbers;
+        std::vector<int>            serverTimes; //first snapshot time, see analyse()
+        std::vector<byte>           flags;
+        std::vector<Message*>       messages;
+
+        int size() const { return (int)offsets.size(); };
+
+        void push_back(std::streamoff offset, int seqNumber) {
+            offsets.push_back(offset);
+            seqNumbers.push_back(seqNumber);
+            serverTimes.push_back(-1);
+            flags.push_back(VEHICLE_NOT_CHECKED);
+            messages.push_back(0);
+        };
 
-        DemoRef() : message(0), vehicleStatus(VEHICLE_NOT_CHECKED) {
+        void clear() {
+            offsets.clear();
+            seqNumbers.clear();
+            serverTimes.clear();
+            flags.clear();
+            messages.clear();
         };
 
+        int getVehicleStatus(int id) const { return flags[id] & INDEX_VEHICLE_MASK; };
+        void setVehicleStatus(int id, int status) {
+            flags[id] = (byte)((flags[id] & ~INDEX_VEHICLE_MASK) | status);
+        };
     };
 
     std::string            demoName;
     std::ifstream          demoFile;
-    std::vector<DemoRef>   messages;
+    MessageIndex           index;
     bool                   loaded;
     bool                   analysed;
+    Projection*            projection;
 
     struct MapRef {
         int         messageId;
@@ -27,42 +63,301 @@ public:
         bool        isMapRestart;
         int         startTime;
         int         endTime;
+        int         timeBase; //server time of map start (configstring 21)
 
         MapRef(int messageId, const std::string& mapName, bool isMapRestart)
             : messageId(messageId), mapName(mapName), isMapRestart(isMapRestart),
-            startTime(0), endTime(0)
+            startTime(0), endTime(0), timeBase(0)
         {};
     };
 
     std::vector<MapRef> maps;
+    ConfigstringTracker configstrings;
 
     Snapshot* getFirstSnapshot(Message* message);
-    int getStartTime(Demo* demo, int mapIndex);
+    int getStartTime(int messageId);
     int getSnapshotTime(Message* message);
+    void notifyMap(ProgressListener* listener, int mapId);
 
     bool isValidIndex(int id);
 
+    //access to messages of the original index
+    void loadMessage(int id, int depth);
+    bool isMessageLoaded(int id, int depth = DECODE_HEADER) const;
+    void unloadMessage(int id);
+    Message* getMessage(int id, int depth);
+    void saveMessage(int id, std::ostream& os);
+
+    /*
+    Edits are kept as piece table over the original index, which is never
+    modified. Piece is range of original messages or of inserted ones. Pieces
+    are kept in treap ordered by position in the edited demo, every node
+    knows number of messages in its subtree, so logical message id is found
+    and edited demo is split or joined at any message in O(log pieces).
+    Original pieces keep their order, they are mapped by their start too,
+    so original id is turned to logical one in O(log pieces) as well.
+    */
+    struct Piece {
+        int     start;      //first message in index or in added
+        int     length;
+        bool    added;
+        int     priority;
+        int     size;       //messages of whole subtree
+        Piece*  left;
+        Piece*  right;
+        Piece*  parent;
+
+        Piece(int start, int length, bool added, int priority)
+            : start(start), length(length), added(added), priority(priority),
+            size(length), left(0), right(0), parent(0)
+        {};
+    };
+
+    bool                    edited;
+    Piece*                  pieces;     //root of treap
+    std::map<int, Piece*>   originals;  //original pieces by start
+    std::vector<Message*>   added;      //inserted messages, owned by demo
+    unsigned int            seed;       //for priorities
+
+    int getCount() const { return edited ? getSize(pieces) : index.size(); };
+    int resolve(int id, Message** addedMessage) const;
+    int toLogical(int id) const;
+    int getTrackedId(int id) const;
+
+    void startEdits();
+    void clearEdits();
+
+    Piece* newPiece(int start, int length, bool added);
+    void deletePieces(Piece* piece);
+    void split(Piece* piece, int count, Piece*& left, Piece*& right);
+    static Piece* merge(Piece* left, Piece* right);
+    static void update(Piece* piece);
+    static int getSize(const Piece* piece) { return piece ? piece->size : 0; };
+    static int getPosition(const Piece* piece);
 };
 
 bool DemoImpl::isValidIndex(int id) {
-    return ((id >= 0) && (id < (int)messages.size()));
+    return ((id >= 0) && (id < index.size()));
+}
+
+/*
+Returns original id of logical message id. Returns -1 for inserted message,
+which is stored to addedMessage (if set), and for invalid id.
+*/
+int DemoImpl::resolve(int id, Message** addedMessage) const {
+    if (addedMessage)
+        *addedMessage = 0;
+
+    if (id < 0 || id >= getCount())
+        return -1;
+
+    if (!edited)
+        return id;
+
+    const Piece* piece = pieces;
+
+    for (;;) {
+        int leftSize = getSize(piece->left);
+
+        if (id < leftSize) {
+            piece = piece->left;
+        }
+        else if (id < leftSize + piece->length) {
+            int offset = piece->start + id - leftSize;
+
+            if (!piece->added)
+                return offset;
+
+            if (addedMessage)
+                *addedMessage = added[offset];
+            return -1;
+        }
+        else {
+            id -= leftSize + piece->length;
+            piece = piece->right;
+        }
+    }
+}
+
+/*
+Returns logical id of original message. When it is deleted, next original
+message which is still there is used (message count when there is none).
+*/
+int DemoImpl::toLogical(int id) const {
+    if (!edited)
+        return id;
+
+    std::map<int, Piece*>::const_iterator it = originals.upper_bound(id);
+
+    if (it != originals.begin()) {
+        --it;
+        const Piece* piece = it->second;
+
+        if (id < piece->start + piece->length)
+            return getPosition(piece) + id - piece->start;
+
+        ++it;
+    }
+
+    if (it == originals.end())
+        return getCount();
+
+    return getPosition(it->second);
+}
+
+/*
+Returns original id for lookups in analysis data (configstrings), inserted
+message gives the last original message before it, -1 when there is none.
+*/
+int DemoImpl::getTrackedId(int id) const {
+    for (; id >= 0; --id) {
+        int original = resolve(id, 0);
+
+        if (original != -1)
+            return original;
+    }
+
+    return -1;
+}
+
+void DemoImpl::startEdits() {
+    if (edited)
+        return;
+
+    edited = true;
+
+    if (index.size() > 0)
+        pieces = newPiece(0, index.size(), false);
+}
+
+void DemoImpl::clearEdits() {
+    deletePieces(pieces);
+    pieces = 0;
+
+    for (int i = 0; i < (int)added.size(); ++i)
+        delete added[i];
+
+    added.clear();
+    edited = false;
 }
 
-void Demo::saveMessage(int id, std::ofstream& os) const {
-    if (!impl->isValidIndex(id))
+DemoImpl::Piece* DemoImpl::newPiece(int start, int length, bool added) {
+    //linear congruential generator, priorities only keep treap balanced
+    seed = seed * 1103515245 + 12345;
+
+    Piece* piece = new Piece(start, length, added, (int)(seed >> 1));
+
+    if (!added)
+        originals[start] = piece;
+
+    return piece;
+}
+
+void DemoImpl::deletePieces(Piece* piece) {
+    if (!piece)
         return;
 
-    if (impl->messages[id].message && impl->messages[id].message->isLoad()) { //if message is loaded, write it from memory
-        impl->messages[id].message->save(os);
+    deletePieces(piece->left);
+    deletePieces(piece->right);
+
+    if (!piece->added)
+        originals.erase(piece->start);
+
+    delete piece;
+}
+
+/*
+Splits pieces to first count messages (left) and the rest (right), piece
+on the boundary is cut in two.
+*/
+void DemoImpl::split(Piece* piece, int count, Piece*& left, Piece*& right) {
+    if (!piece) {
+        left = right = 0;
+        return;
+    }
+
+    int leftSize = getSize(piece->left);
+
+    if (count <= leftSize) {
+        split(piece->left, count, left, piece->left);
+        right = piece;
+    }
+    else if (count >= leftSize + piece->length) {
+        split(piece->right, count - leftSize - piece->length, piece->right, right);
+        left = piece;
+    }
+    else {
+        int offset = count - leftSize;
+        Piece* rest = newPiece(piece->start + offset, piece->length - offset, piece->added);
+
+        piece->length = offset;
+        right = merge(rest, piece->right);
+        piece->right = 0;
+        left = piece;
+    }
+
+    update(piece);
+
+    if (left)
+        left->parent = 0;
+    if (right)
+        right->parent = 0;
+}
+
+//joins pieces, all of left go before right
+DemoImpl::Piece* DemoImpl::merge(Piece* left, Piece* right) {
+    if (!left)
+        return right;
+    if (!right)
+        return left;
+
+    if (left->priority > right->priority) {
+        left->right = merge(left->right, right);
+        update(left);
+        return left;
+    }
+
+    right->left = merge(left, right->left);
+    update(right);
+    return right;
+}
+
+void DemoImpl::update(Piece* piece) {
+    piece->size = piece->length + getSize(piece->left) + getSize(piece->right);
+
+    if (piece->left)
+        piece->left->parent = piece;
+    if (piece->right)
+        piece->right->parent = piece;
+}
+
+//logical id of the first message of piece
+int DemoImpl::getPosition(const Piece* piece) {
+    int position = getSize(piece->left);
+
+    for (; piece->parent; piece = piece->parent)
+        if (piece->parent->right == piece)
+            position += getSize(piece->parent->left) + piece->parent->length;
+
+    return position;
+}
+
+void DemoImpl::saveMessage(int id, std::ostream& os) {
+    if (!isValidIndex(id))
+        return;
+
+    if (isMessageLoaded(id, DECODE_FULL) && !index.messages[id]->isProjected()) {
+        //if message is loaded, write it from memory
+        index.messages[id]->save(os);
     }
     else { //otherwise copy from source file
-        impl->demoFile.seekg(impl->messages[id].offset, impl->demoFile.beg);
+        demoFile.seekg(index.offsets[id], demoFile.beg);
 
         int snumber, msglen;
         char buffer[MAX_MSGLEN];
-        impl->demoFile.read((char*)&snumber, sizeof(snumber));
-        impl->demoFile.read((char*)&msglen, sizeof(msglen));
-        impl->demoFile.read((char*)&buffer, msglen);
+        demoFile.read((char*)&snumber, sizeof(snumber));
+        demoFile.read((char*)&msglen, sizeof(msglen));
+        demoFile.read((char*)&buffer, msglen);
 
         os.write((char*)&snumber, sizeof(snumber));
         os.write((char*)&msglen, sizeof(msglen));
@@ -70,10 +365,24 @@ void Demo::saveMessage(int id, std::ofstream& os) const {
     }
 }
 
+void Demo::saveMessage(int id, std::ostream& os) const {
+    Message* message;
+    int original = impl->resolve(id, &message);
+
+    if (message)
+        message->save(os);
+    else if (original != -1)
+        impl->saveMessage(original, os);
+}
+
 Demo::Demo() : impl(new DemoImpl())
 {
     impl->loaded = false;
     impl->analysed = false;
+    impl->projection = 0;
+    impl->edited = false;
+    impl->pieces = 0;
+    impl->seed = 1;
 }
 
 Demo::~Demo() {
@@ -92,31 +401,30 @@ bool Demo::open(const char* filename, bool analysis) {
 
     //log end offset
     impl->demoFile.seekg(0, std::ios_base::end);
-    int end = (int)impl->demoFile.tellg();
+    std::streamoff end = impl->demoFile.tellg();
 
     impl->demoFile.seekg(0, impl->demoFile.beg);
 
-    int len;
-    DemoImpl::DemoRef ref; //dummy ref
+    int len, seqNumber;
+    std::streamoff offset;
 
     do {
-        ref.offset = (int)impl->demoFile.tellg();
-        ref.message = 0;
+        offset = impl->demoFile.tellg();
 
         if (impl->demoFile.eof())
             continue;
 
         if (!impl->demoFile.fail())
-            impl->demoFile.seekg(4, impl->demoFile.cur);
+            impl->demoFile.read((char*)&seqNumber, 4);
         if (!impl->demoFile.fail())
             impl->demoFile.read((char*)&len, 4);
 
-        if ((int)impl->demoFile.tellg() > end - len)
+        if (impl->demoFile.tellg() > end - len)
             break; //truncated demo
 
         if (!impl->demoFile.fail() && (len != -1)) {
             impl->demoFile.seekg(len, impl->demoFile.cur);
-            impl->messages.push_back(ref);
+            impl->index.push_back(offset, seqNumber);
         }
 
     } while (!impl->demoFile.eof() && !impl->demoFile.fail() && (len != -1));
@@ -127,30 +435,35 @@ bool Demo::open(const char* filename, bool analysis) {
     return (impl->loaded = true);
 }
 
-void Demo::analyse() {
+void Demo::analyse(ProgressListener* listener) {
 
     if (impl->analysed)
         return;
 
     impl->maps.clear();
+    impl->configstrings.clear();
     Message::forceVehicleLoad = false;
 
     int lastSnapFlags = -1;
     int lastSnapTime = -1;
     bool awaitingMapChange = false;
-    int count = getMessageCount();
+    int count = impl->index.size();
     int messageId = 0;
     Message* msg;
 
     for (; messageId < count; ++messageId) {
-        msg = getMessage(messageId);
+        if (listener && (messageId % 64) == 0 && !listener->progress(messageId, count))
+            throw DemoException("analysis cancelled");
+
+        //entities are not needed for analysis
+        msg = impl->getMessage(messageId, DECODE_PLAYERSTATE);
 
-        impl->messages[messageId].vehicleStatus = VEHICLE_NOT_CHECKED;
+        impl->index.setVehicleStatus(messageId, VEHICLE_NOT_CHECKED);
 
         if (!msg)
             continue;
 
-        Message::forceVehicleLoad = false; //global
+        impl->configstrings.addMessage(messageId, msg);
 
         Instruction* instr;
         for (int i = 0; i < msg->getInstructionsCount(); ++i) {
@@ -162,15 +475,10 @@ void Demo::analyse() {
                 //check snapshots for vehicle boarding/leaving or map restart
 
                 /*
-                Note: At this point, we might have loaded
-                wrong packets entities instead of vehicle state,
-                but that is not a problem, since we need to
-                check only playerstate or pilotstate and they
-                are loaded fine
-
-
-                HOWEVER, we MUST check if there is not another instruction
-                following after this one, because it might be incorrectly loaded
+                Note: At this point, vehicle state might be missing,
+                but that is not a problem, since we need to check only
+                playerstate or pilotstate. Snapshot is decoded only up to
+                playerstate, so nothing following it is misread.
                 */
 
                 Snapshot* snap = instr->getSnapshot();
@@ -186,11 +494,13 @@ void Demo::analyse() {
                         //snap flag 4 switched => restart
 
                         //log ending time for previous map
-                        int mapTime = impl->getStartTime(this, (int)impl->maps.size() - 1);
+                        int mapTime = impl->maps.back().timeBase;
                         impl->maps[impl->maps.size() - 1].endTime = (lastSnapTime - mapTime) / 1000;
+                        impl->notifyMap(listener, (int)impl->maps.size() - 1);
 
                         //insert
                         impl->maps.push_back(DemoImpl::MapRef(messageId, "restart", true));
+                        impl->maps.back().timeBase = impl->getStartTime(messageId);
                     }
                 }
                 lastSnapFlags = snap->getSnapflags() & 4;
@@ -205,9 +515,9 @@ void Demo::analyse() {
                 //check for change in this snapshot
                 if (ps->isAtributeSet(vehicleId)) {
                     if (ps->getAtributeInt(vehicleId))
-                        impl->messages[messageId].vehicleStatus = VEHICLE_INSIDE;
+                        impl->index.setVehicleStatus(messageId, VEHICLE_INSIDE);
                     else
-                        impl->messages[messageId].vehicleStatus = VEHICLE_NOT_INSIDE;
+                        impl->index.setVehicleStatus(messageId, VEHICLE_NOT_INSIDE);
 
                     continue;
                 }
@@ -219,7 +529,7 @@ void Demo::analyse() {
                 deltanum = snap->getDeltanum();
 
                 if (!deltanum) {
-                    impl->messages[messageId].vehicleStatus = VEHICLE_NOT_INSIDE;
+                    impl->index.setVehicleStatus(messageId, VEHICLE_NOT_INSIDE);
                     continue;
                 }
 
@@ -234,8 +544,8 @@ void Demo::analyse() {
                 minId = 0;
 
                 do {
-                    foundSeqNumber = getMessage(guessingId)->getSeqNumber();
-                    //unloadMessage(guessingId);
+                    //sequence numbers are indexed, no need to load anything
+                    foundSeqNumber = impl->index.seqNumbers[guessingId];
 
                     if (seekingSeqNumber < foundSeqNumber) {
                         maxId = guessingId;
@@ -251,29 +561,17 @@ void Demo::analyse() {
 
                 if (minId == maxId) { //something went wrong, we didnt find seeking seq number
                     guessingId = messageId - deltanum;
-                    impl->messages[guessingId].vehicleStatus = VEHICLE_NOT_INSIDE;
+                    impl->index.setVehicleStatus(guessingId, VEHICLE_NOT_INSIDE);
                 }
 
                 //we found matching message, get its vehicleStatus
-                impl->messages[messageId].vehicleStatus = impl->messages[guessingId].vehicleStatus;
+                impl->index.setVehicleStatus(messageId, impl->index.getVehicleStatus(guessingId));
 
-                if (impl->messages[messageId].vehicleStatus == VEHICLE_NOT_CHECKED) {
+                if (impl->index.getVehicleStatus(messageId) == VEHICLE_NOT_CHECKED) {
                     std::string s = "Vehicle status wasnt checked correctly ";
                     s += seekingSeqNumber;
                     throw DemoException(s.c_str());
                 }
-
-                if ((impl->messages[messageId].vehicleStatus == VEHICLE_INSIDE) &&
-                    (!snap->getVehiclestate()) &&
-                    (i < msg->getInstructionsCount() - 1)) {
-                    //we are in vehicle, we didnt read snapshot properly AND
-                    //according to readed information there is another instruction after this one
-                    //we need reload
-                    Message::forceVehicleLoad = true;
-                    break;
-                }
-
-
             }
             else if (instr->getType() == INSTR_GAMESTATE) {
                 //check gamestates for new map beginning
@@ -299,8 +597,9 @@ void Demo::analyse() {
                 int currentTime = lastSnapTime;
                 int mapTime;
                 if (impl->maps.size() > 0) {
-                    mapTime = impl->getStartTime(this, (int)impl->maps.size() - 1);
+                    mapTime = impl->maps.back().timeBase;
                     impl->maps[impl->maps.size() - 1].endTime = (currentTime - mapTime) / 1000;
+                    impl->notifyMap(listener, (int)impl->maps.size() - 1);
                 }
 
                 //insert new map
@@ -309,8 +608,9 @@ void Demo::analyse() {
                     false));
 
                 //log beginning time for new map
-                currentTime = impl->getFirstSnapshot(getMessage(messageId + 1))->getServertime();
-                mapTime = impl->getStartTime(this, (int)impl->maps.size() - 1);
+                currentTime = impl->getFirstSnapshot(impl->getMessage(messageId + 1, DECODE_PLAYERSTATE))->getServertime();
+                mapTime = impl->getStartTime(messageId);
+                impl->maps.back().timeBase = mapTime;
                 impl->maps[impl->maps.size() - 1].startTime = (currentTime - mapTime) / 1000;
 
                 awaitingMapChange = false;
@@ -322,12 +622,12 @@ void Demo::analyse() {
 
         }
 
-        if ((impl->messages[messageId].vehicleStatus == VEHICLE_NOT_CHECKED)
+        if ((impl->index.getVehicleStatus(messageId) == VEHICLE_NOT_CHECKED)
             && messageId > 0) {
             //this is probably pure gamestate message, lets use vehicle status from previous message
-            impl->messages[messageId].vehicleStatus = impl->messages[messageId - 1].vehicleStatus;
+            impl->index.setVehicleStatus(messageId, impl->index.getVehicleStatus(messageId - 1));
 
-            if (impl->messages[messageId].vehicleStatus == VEHICLE_NOT_CHECKED) {
+            if (impl->index.getVehicleStatus(messageId) == VEHICLE_NOT_CHECKED) {
                 std::string s = "Vehicle status wasnt checked correctly for msg ";
                 s += messageId;
                 throw DemoException(s.c_str());
@@ -335,22 +635,30 @@ void Demo::analyse() {
 
         }
 
-        if (Message::forceVehicleLoad) {
-            unloadMessage(messageId);
-            --messageId;
-        }
-        else if (messageId - 16 >= 0) {
-            unloadMessage(messageId - 16);
-        }
+        //server times are kept nondecreasing inside the map for binary search,
+        //messages without snapshot get time of previous snapshot
+        int serverTime = impl->getSnapshotTime(msg);
+        if (serverTime != -1)
+            impl->index.flags[messageId] |= INDEX_SNAPSHOT;
+        else if (!impl->maps.empty() && messageId > impl->maps.back().messageId)
+            serverTime = impl->index.serverTimes[messageId - 1];
+        impl->index.serverTimes[messageId] = serverTime;
+
+        if (messageId - 16 >= 0)
+            impl->unloadMessage(messageId - 16);
     }
 
     //unload last 16 messages
     for (messageId = count - 16; messageId < count; ++messageId)
-        unloadMessage(messageId);
+        impl->unloadMessage(messageId);
 
     //log end time for last map
-    int mapTime = impl->getStartTime(this, (int)impl->maps.size() - 1);
+    int mapTime = impl->maps.back().timeBase;
     impl->maps[impl->maps.size() - 1].endTime = (lastSnapTime - mapTime) / 1000;
+    impl->notifyMap(listener, (int)impl->maps.size() - 1);
+
+    if (listener)
+        listener->progress(count, count);
 
     impl->analysed = true;
 }
@@ -367,11 +675,12 @@ void Demo::close() {
     impl->demoFile.close();
     impl->demoName.clear();
 
-    for (std::vector<DemoImpl::DemoRef>::iterator it = impl->messages.begin();
-        it != impl->messages.end(); ++it)
-        if (it->message) delete it->message;
+    for (std::vector<Message*>::iterator it = impl->index.messages.begin();
+        it != impl->index.messages.end(); ++it)
+        if (*it) delete* it;
 
-    impl->messages.clear();
+    impl->index.clear();
+    impl->clearEdits();
 
     impl->maps.clear();
 }
@@ -395,31 +704,39 @@ bool Demo::save(const char* filename, bool endSign) const {
     return true;
 }
 
-void Demo::loadMessage(int id) {
-    if (isMessageLoaded(id))
+void DemoImpl::loadMessage(int id, int depth) {
+    if (isMessageLoaded(id, depth))
         return;
 
-    impl->demoFile.seekg(impl->messages[id].offset, impl->demoFile.beg);
+    demoFile.seekg(index.offsets[id], demoFile.beg);
 
     //our vehicle magic
-    if (impl->analysed) {
-        if (impl->messages[id].vehicleStatus == VEHICLE_INSIDE)
+    if (analysed) {
+        if (index.getVehicleStatus(id) == VEHICLE_INSIDE)
             Message::forceVehicleLoad = true;
         else
             Message::forceVehicleLoad = false;
     }
 
-    if (!impl->messages[id].message) {
-        impl->messages[id].message = new Message();
+    Message*& message = index.messages[id];
+
+    if (!message) {
+        message = new Message();
+    }
+    else {
+        message->clear(); //partially loaded before
     }
 
-    if (impl->analysed) { //we did analysis, we can believe clean fast way
-        impl->messages[id].message->load(impl->demoFile);
+    Message::decodeDepth = depth;
+    Message::projection = projection;
+
+    if (analysed) { //we did analysis, we can believe clean fast way
+        message->load(demoFile);
     }
     else {
         //not analysed, we must try eventually both variants (without and with vehicles)
         try {
-            impl->messages[id].message->load(impl->demoFile);
+            message->load(demoFile);
         }
         catch (std::exception& e) {
             if (Message::forceVehicleLoad) {
@@ -427,84 +744,194 @@ void Demo::loadMessage(int id) {
             }
             else { //try again with forcing vehicle load
                 Message::forceVehicleLoad = true;
-                impl->messages[id].message->clear();
-                impl->demoFile.seekg(impl->messages[id].offset, impl->demoFile.beg);
-                impl->messages[id].message->load(impl->demoFile);
+                message->clear();
+                demoFile.seekg(index.offsets[id], demoFile.beg);
+                message->load(demoFile);
                 Message::forceVehicleLoad = false;
             }
         }
 
     }
 
+    Message::decodeDepth = DECODE_FULL;
+    Message::projection = 0;
+
     //failed
-    if (!impl->messages[id].message->isLoad()) {
-        delete impl->messages[id].message;
-        impl->messages[id].message = 0;
+    if (!message->isLoad()) {
+        delete message;
+        message = 0;
     }
 }
 
-bool Demo::isMessageLoaded(int id) const {
-    if (!isOpen())
+bool DemoImpl::isMessageLoaded(int id, int depth) const {
+    if (!loaded)
         return false;
 
-    if ((id < 0) || (id > (int)(impl->messages.size() - 1)))
+    if (id < 0 || id >= index.size())
         return false;
 
-    if (impl->messages[id].message && impl->messages[id].message->isLoad())
+    if (index.messages[id] && index.messages[id]->isLoad()
+        && index.messages[id]->getDecodeDepth() >= depth)
         return true;
 
     return false;
 }
 
-void Demo::unloadMessage(int id) {
+void DemoImpl::unloadMessage(int id) {
     if (!isMessageLoaded(id))
         return;
 
-    delete impl->messages[id].message;
-    impl->messages[id].message = 0;
+    delete index.messages[id];
+    index.messages[id] = 0;
 }
 
-Message* Demo::getMessage(int id) {
-    if (!isOpen())
+Message* DemoImpl::getMessage(int id, int depth) {
+    if (!loaded)
         return 0;
 
-    if ((id < 0) || (id > (int)(impl->messages.size() - 1)))
+    if (!isValidIndex(id))
         return 0;
 
-    loadMessage(id);
+    loadMessage(id, depth);
 
-    if (!isMessageLoaded(id))
+    if (!isMessageLoaded(id, depth))
         return 0;
 
 
-    return impl->messages[id].message;
+    return index.messages[id];
+}
+
+void Demo::loadMessage(int id, int depth) {
+    int original = impl->resolve(id, 0);
+
+    //inserted messages are always in memory
+    if (original != -1)
+        impl->loadMessage(original, depth);
+}
+
+bool Demo::isMessageLoaded(int id, int depth) const {
+    Message* message;
+    int original = impl->resolve(id, &message);
+
+    if (message)
+        return message->isLoad() && message->getDecodeDepth() >= depth;
+
+    return (original != -1) && impl->isMessageLoaded(original, depth);
+}
+
+void Demo::unloadMessage(int id) {
+    int original = impl->resolve(id, 0);
+
+    if (original != -1)
+        impl->unloadMessage(original);
+}
+
+Message* Demo::getMessage(int id, int depth) {
+    Message* message;
+    int original = impl->resolve(id, &message);
+
+    if (message)
+        return message;
+
+    if (original == -1)
+        return 0;
+
+    return impl->getMessage(original, depth);
+}
+
+void Demo::setProjection(Projection* projection) {
+    if (impl->projection == projection)
+        return;
+
+    //loaded messages could be decoded with other projection
+    for (int i = 0; i < impl->index.size(); ++i)
+        impl->unloadMessage(i);
+
+    impl->projection = projection;
+}
+
+Projection* Demo::getProjection() const {
+    return impl->projection;
 }
 
 int Demo::getMessageCount() const {
-    return (int)impl->messages.size();
+    return impl->getCount();
+}
+
+int Demo::getMessageSeqNumber(int id) const {
+    Message* message;
+    int original = impl->resolve(id, &message);
+
+    if (message)
+        return message->getSeqNumber();
+
+    if (original == -1)
+        return -1;
+
+    return impl->index.seqNumbers[original];
+}
+
+int Demo::getOriginalId(int id) const {
+    return impl->resolve(id, 0);
 }
 
 void Demo::deleteMessage(int startid, int endid) {
     if (!isOpen())
         return;
 
-    if ((startid < 0) || (startid > (int)(impl->messages.size() - 1)))
+    if (startid < 0 || startid >= getMessageCount())
         return;
 
-    if (endid > startid) {
-        if (endid >= (int)(impl->messages.size()))
-            impl->messages.erase(impl->messages.begin() + startid, impl->messages.end());
-        else
-            impl->messages.erase(impl->messages.begin() + startid, impl->messages.begin() + endid);
-    }
-    else {
-        if (impl->messages[startid].message) {
-            delete impl->messages[startid].message;
-        }
+    if (endid <= startid)
+        endid = startid + 1;
+    if (endid > getMessageCount())
+        endid = getMessageCount();
+
+    //only pieces are cut out, original index stays
+    DemoImpl::Piece* left;
+    DemoImpl::Piece* rest;
+    DemoImpl::Piece* deleted;
+    DemoImpl::Piece* right;
+
+    impl->startEdits();
+    impl->split(impl->pieces, startid, left, rest);
+    impl->split(rest, endid - startid, deleted, right);
+    impl->deletePieces(deleted);
+    impl->pieces = DemoImpl::merge(left, right);
+}
 
-        impl->messages.erase(impl->messages.begin() + startid);
-    }
+void Demo::insertMessage(int id, Message* message) {
+    assert(message);
+
+    if (!isOpen() || id < 0 || id > getMessageCount())
+        throw DemoException("message insert position out of range");
 
+    DemoImpl::Piece* left;
+    DemoImpl::Piece* right;
+
+    impl->startEdits();
+    impl->added.push_back(message);
+    impl->split(impl->pieces, id, left, right);
+    left = DemoImpl::merge(left, impl->newPiece((int)impl->added.size() - 1, 1, true));
+    impl->pieces = DemoImpl::merge(left, right);
+}
+
+void Demo::replaceMessage(int id, Message* message) {
+    assert(message);
+
+    if (!isOpen() || id < 0 || id >= getMessageCount())
+        throw DemoException("message index out of range");
+
+    deleteMessage(id);
+    insertMessage(id, message);
+}
+
+bool Demo::isEdited() const {
+    return impl->edited;
+}
+
+void Demo::revert() {
+    impl->clearEdits();
 }
 
 //times extraction routines
@@ -517,49 +944,27 @@ Snapshot* DemoImpl::getFirstSnapshot(Message* message) {
     return 0;
 }
 
-int DemoImpl::getStartTime(Demo* demo, int mapIndex) {
-    Message* firstMessage = demo->getMessage(demo->getMapId(mapIndex));
-    if (!firstMessage)
-        return -1;
+int DemoImpl::getStartTime(int messageId) {
+    //new time is in gamestate or in cs command of restart,
+    //both are already tracked
+    std::string s = configstrings.getConfigstring(messageId, CS_LEVEL_START_TIME);
 
-    int ret;
-
-    if (demo->isMapRestart(mapIndex)) {
-        //ok map restart, we should find new map time in server command
-        ServerCommand* command;
-        std::string str;
-        for (int i = 0; i < firstMessage->getInstructionsCount(); ++i) {
-            if (command = firstMessage->getInstruction(i)->getServerCommand()) {
-                str = command->getCommand();
-                if (str.substr(0, 6) == "cs 21 ") {
-                    std::stringstream stream(str.substr(7, str.size() - 7 - 2));
-                    if ((stream >> ret)) {
-                        return ret;
-                    }
-                }
-            }
-        }
+    char* end;
+    int ret = (int)strtol(s.c_str(), &end, 10);
 
-        throw DemoException("restart time extraction failed");
+    if (end == s.c_str())
+        throw DemoException("map start time extraction failed");
 
-    }
-    else { //new map begins
-        // we find new time directly in gamestate
-        //configstring 21
-        Gamestate* gamestate;
-        for (int i = 0; i < firstMessage->getInstructionsCount(); ++i) {
-            gamestate = firstMessage->getInstruction(i)->getGamestate();
-
-            if (gamestate) {
-                std::stringstream stream(gamestate->getConfigstring(21));
-                if (!(stream >> ret))
-                    throw DemoException("gamestate time extraction failed");
-                return ret;
-            }
-        }
-    }
+    return ret;
+}
 
-    return -1;
+//map times are final when next map is found
+void DemoImpl::notifyMap(ProgressListener* listener, int mapId) {
+    if (!listener)
+        return;
+
+    const MapRef& map = maps[mapId];
+    listener->mapAnalysed(mapId, map.mapName, map.isMapRestart, map.startTime, map.endTime);
 }
 
 int DemoImpl::getSnapshotTime(Message* message) {
@@ -586,7 +991,7 @@ std::string Demo::getMapName(int mapId) const {
 
 int Demo::getMapId(int mapId) const {
     assert((mapId >= 0) && (mapId < impl->maps.size()));
-    return impl->maps[mapId].messageId;
+    return impl->toLogical(impl->maps[mapId].messageId);
 }
 
 bool Demo::isMapRestart(int mapId) const {
@@ -604,4 +1009,45 @@ int Demo::getMapEndTime(int mapId) const {
     return impl->maps[mapId].endTime;
 }
 
+const ConfigstringTracker* Demo::getConfigstrings() const {
+    return &impl->configstrings;
+}
+
+void Demo::getConfigstrings(int id, ConfigstringTracker::stringmap& strings) const {
+    int original = impl->getTrackedId(id);
+
+    if (original == -1)
+        strings.clear();
+    else
+        impl->configstrings.getConfigstrings(original, strings);
+}
+
+int Demo::getMessageServerTime(int id) const {
+    Message* message;
+    int original = impl->resolve(id, &message);
+
+    if (message)
+        return impl->getSnapshotTime(message);
+
+    if (original == -1 || !(impl->index.flags[original] & INDEX_SNAPSHOT))
+        return -1;
+
+    return impl->index.serverTimes[original];
+}
+
+int Demo::findMessageAtTime(int mapId, int ms) const {
+    assert((mapId >= 0) && (mapId < impl->maps.size()));
+
+    int begin = impl->maps[mapId].messageId;
+    int end = (mapId + 1 < (int)impl->maps.size()) ? impl->maps[mapId + 1].messageId
+        : impl->index.size();
+
+    //server times are nondecreasing inside the map
+    std::vector<int>::const_iterator it = std::lower_bound(
+        impl->index.serverTimes.begin() + begin, impl->index.serverTimes.begin() + end,
+        impl->maps[mapId].timeBase + ms);
+
+    return impl->toLogical((int)(it - impl->index.serverTimes.begin()));
+}
+
 DEMO_NAMESPACE_END
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define DEMO_H
 
 #include "message.h"
+#include "configstrings.h"
 
 DEMO_NAMESPACE_START
 
@@ -11,6 +12,25 @@ enum {
     VEHICLE_NOT_INSIDE
 };
 
+/*
+Receives progress of long operations (analysis, cutting). It is called from
+the thread running the operation. Returning false from progress() cancels
+the operation, which then throws DemoException.
+*/
+class ProgressListener {
+public:
+    virtual ~ProgressListener() {};
+
+    virtual bool progress(int done, int total) = 0;
+
+    /*
+    Called by Demo::analyse() when map is analysed and its times are final,
+    so map list can be shown before analysis ends.
+    */
+    virtual void mapAnalysed(int /*mapId*/, const std::string& /*mapName*/, bool /*isMapRestart*/,
+        int /*startTime*/, int /*endTime*/) {};
+};
+
 class DemoImpl;
 
 class Demo
@@ -57,9 +77,18 @@ public:
     /*
     Loads message from input demo file, unless this message has been already loaded.
     In that case it does nothing.
+
+    depth - how deep snapshot should be decoded (DECODE_HEADER, DECODE_PLAYERSTATE
+           or DECODE_FULL). Partially loaded message is reloaded when deeper decoding
+           is requested. Partially loaded messages are saved as copy from input file,
+           so any changes to them are lost.
+    */
+    void loadMessage(int id, int depth = DECODE_FULL);
+
+    /*
+    Checks whether message is loaded at least to given depth.
     */
-    void loadMessage(int id);
-    bool isMessageLoaded(int id) const;
+    bool isMessageLoaded(int id, int depth = DECODE_HEADER) const;
 
     /*
     Completely unloads message from memory, only indexing and
@@ -72,17 +101,38 @@ public:
     Perform special analysis. This check is needed to know about
     maps/restarts distribution in demo aswell as to be able
     correctly load messages containing vehicles.
+
+    listener - optional, gets messages analysed out of total and analysed maps,
+           analysis can be cancelled by it
     */
-    void analyse();
+    void analyse(ProgressListener* listener = 0);
 
     /*
-    Returns pointer to selected message. If message isnt yet loaded,
-    loadMessage() is called.
+    Returns pointer to selected message. If message isnt yet loaded
+    to given depth, loadMessage() is called.
     */
-    Message* getMessage(int id);
+    Message* getMessage(int id, int depth = DECODE_FULL);
+
+    /*
+    Sets projection used for loading of messages (see Projection), only selected
+    fields are stored in loaded messages. Projection isnt copied, it must stay valid
+    while it is set. Already loaded messages are unloaded. Messages loaded with
+    projection are saved as copy from input file, so any changes to them are lost.
+
+    projection - projection to be used, 0 turns projection off
+    */
+    void setProjection(Projection* projection);
+
+    Projection* getProjection() const;
 
     int getMessageCount() const;
 
+    /*
+    Returns sequence number of selected message. Sequence numbers are
+    stored in index while opening, so message doesnt need to be loaded.
+    */
+    int getMessageSeqNumber(int id) const;
+
     /*
     Returns number of map changes and restarts. analyse() must be called
     before this.
@@ -121,21 +171,82 @@ public:
     */
     int getMapEndTime(int mapId) const;
 
+    /*
+    Gives configstrings of the demo, they can be rebuilt for any message.
+    Tracker uses ids of original messages (see getOriginalId()). analyse()
+    must be called before this.
+    */
+    const ConfigstringTracker* getConfigstrings() const;
+
+    /*
+    Gives full configstring set valid after message id. Inserted message
+    gives set of the last original message before it, its own commands
+    arent tracked. analyse() must be called before this.
+    */
+    void getConfigstrings(int id, ConfigstringTracker::stringmap& strings) const;
+
+    /*
+    Gives server time of the first snapshot in selected message or -1 when message
+    has no snapshot. Times are recorded by analyse(), nothing is loaded.
+    */
+    int getMessageServerTime(int id) const;
+
+    /*
+    Finds first message of selected map, whose snapshot is at least ms milliseconds
+    from the map start. Uses binary search over server times recorded by analyse().
+    Returns index of first message of the next map (or message count for the last
+    map) when there is no such message.
+    */
+    int findMessageAtTime(int mapId, int ms) const;
+
     /*
     Save selected message to output stream. Used for manually saving
     only desired messages. Use save() to save whole demo.
     */
-    void saveMessage(int id, std::ofstream& os) const;
+    void saveMessage(int id, std::ostream& os) const;
+
+    /*
+    Messages can be edited without touching the original demo. Edits are kept
+    as overlay over original messages, message ids used by all methods are ids
+    in the edited demo and save() writes edited demo. Analysis information
+    (maps, times, configstrings) is about original messages, map and time
+    lookups give ids in the edited demo. Edits take O(log n) of number of
+    edited ranges, index isnt shifted.
+    */
 
     /*
-    Delete message(s) from memory aswell as all indexing or analysed info. This
-    will corrupted demo format unless you correct all messages refering to this one.
+    Deletes message(s) from the edited demo, original message stays in source
+    file and index, so deleting is cheap and can be reverted. This will corrupt
+    demo format unless you correct all messages refering to this one.
 
     id - index of first message to be deleted
-    endid - index of last message to be deleted, only matters when endid > id
+    endid - index after the last message to be deleted, only matters when endid > id
     */
     void deleteMessage(int startid, int endid = 0);
 
+    /*
+    Inserts message before message id (id equal to message count appends it).
+    Demo takes ownership of the message, it must be fully loaded.
+    */
+    void insertMessage(int id, Message* message);
+
+    /*
+    Replaces message id by given message, demo takes ownership of it.
+    */
+    void replaceMessage(int id, Message* message);
+
+    bool isEdited() const;
+
+    /*
+    Drops all edits, demo is same as after opening, nothing is reloaded.
+    */
+    void revert();
+
+    /*
+    Gives id of message in the original demo, -1 for inserted message.
+    */
+    int getOriginalId(int id) const;
+
 };
 
 DEMO_NAMESPACE_END
@@ -0,0 +1,259 @@
+#include "demoreader.h"
+#include "demo.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <cstdio>
+#endif
+
+DEMO_NAMESPACE_START
+
+class DemoReaderImpl {
+public:
+    struct VehicleRef {
+        int seqNumber;
+        int vehicleStatus;
+    };
+
+    std::ifstream   demoFile;
+    std::istream*   input;
+    Message         message;
+    int             count;
+    long long       bytesRead;
+    Projection*     projection;
+    int             depth;
+    bool            corrupted;  //last next() failed on message, not on the end
+
+    //vehicle status of last PACKET_BACKUP messages, indexed by sequence
+    //number, these are the only messages snapshot can be delta from
+    VehicleRef      history[PACKET_BACKUP];
+    int             lastVehicleStatus;
+
+    void reset();
+    Snapshot* getFirstSnapshot();
+    int checkVehicleStatus();
+    void decode(bool forceVehicleLoad);
+};
+
+void DemoReaderImpl::reset() {
+    input = 0;
+    count = 0;
+    bytesRead = 0;
+    corrupted = false;
+    lastVehicleStatus = VEHICLE_NOT_INSIDE;
+
+    for (int i = 0; i < PACKET_BACKUP; ++i) {
+        history[i].seqNumber = -1;
+        history[i].vehicleStatus = VEHICLE_NOT_CHECKED;
+    }
+}
+
+Snapshot* DemoReaderImpl::getFirstSnapshot() {
+    for (int i = 0; i < message.getInstructionsCount(); ++i)
+        if (message.getInstruction(i)->getType() == INSTR_SNAPSHOT)
+            return message.getInstruction(i)->getSnapshot();
+
+    return 0;
+}
+
+/*
+Same rules as Demo::analyse() uses, but we can look only back
+to the messages we have already read.
+*/
+int DemoReaderImpl::checkVehicleStatus() {
+    Snapshot* snap = getFirstSnapshot();
+
+    if (!snap) //no snapshot (gamestate etc.), nothing changes
+        return lastVehicleStatus;
+
+    PlayerState* ps = snap->getPlayerstate();
+    int vehicleId = (ps->getType() == STATE_PILOTSTATE) ? 31 : 84;
+
+    if (ps->isAtributeSet(vehicleId))
+        return ps->getAtributeInt(vehicleId) ? VEHICLE_INSIDE : VEHICLE_NOT_INSIDE;
+
+    //uncompressed frame without vehicle set
+    if (!snap->getDeltanum())
+        return VEHICLE_NOT_INSIDE;
+
+    int seekingSeqNumber = message.getSeqNumber() - snap->getDeltanum();
+    const VehicleRef& ref = history[seekingSeqNumber & PACKET_MASK];
+
+    if (ref.seqNumber == seekingSeqNumber)
+        return ref.vehicleStatus;
+
+    return VEHICLE_NOT_INSIDE; //delta message not in demo
+}
+
+void DemoReaderImpl::decode(bool forceVehicleLoad) {
+    message.clear();
+    Message::forceVehicleLoad = forceVehicleLoad;
+    Message::decodeDepth = depth;
+    Message::projection = projection;
+    message.decode();
+}
+
+DemoReader::DemoReader() : impl(new DemoReaderImpl()) {
+    impl->projection = 0;
+    impl->depth = DECODE_FULL;
+    impl->reset();
+}
+
+DemoReader::~DemoReader() {
+    close();
+    delete impl;
+}
+
+bool DemoReader::open(const char* filename) {
+    if (isOpen())
+        close();
+
+    if (std::string(filename) == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        return open(std::cin);
+    }
+
+    impl->demoFile.open(filename, std::ios::binary);
+
+    if (!impl->demoFile.is_open())
+        return false;
+
+    return open(impl->demoFile);
+}
+
+bool DemoReader::open(std::istream& is) {
+    if (isOpen() && impl->input != &is)
+        close();
+
+    impl->reset();
+    impl->input = &is;
+
+    return !is.fail();
+}
+
+bool DemoReader::isOpen() const {
+    return impl->input != 0;
+}
+
+void DemoReader::close() {
+    if (impl->demoFile.is_open())
+        impl->demoFile.close();
+
+    impl->message.clear();
+    impl->reset();
+}
+
+bool DemoReader::next() {
+    if (!isOpen())
+        return false;
+
+    std::istream& is = *impl->input;
+    int seqNumber, msglen;
+
+    impl->message.clear();
+
+    is.read((char*)&seqNumber, sizeof(seqNumber));
+    is.read((char*)&msglen, sizeof(msglen));
+
+    if (is.fail() || (seqNumber == -1 && msglen == -1)) //ending message
+        return false;
+
+    try {
+        Message::buffer.load(is, msglen);
+    }
+    catch (std::exception&) { //bad length, rest of the stream cant be trusted
+        impl->corrupted = true;
+        return false;
+    }
+
+    if (is.gcount() != msglen) { //truncated demo
+        Message::buffer.clean();
+        return false;
+    }
+
+    impl->bytesRead += sizeof(seqNumber) + sizeof(msglen) + msglen;
+    impl->message.setSeqNumber(seqNumber);
+
+    //vehicle status rarely changes, so guess it is same as in last message
+    bool forced = (impl->lastVehicleStatus == VEHICLE_INSIDE);
+
+    int vehicleStatus;
+
+    try {
+        try {
+            impl->decode(forced);
+        }
+        catch (std::exception&) {
+            //wrong guess, data are still in buffer (see MessageBuffer::clean), try other variant
+            forced = !forced;
+            impl->decode(forced);
+        }
+
+        vehicleStatus = impl->checkVehicleStatus();
+        Snapshot* snap = impl->getFirstSnapshot();
+
+        if (snap && impl->depth >= DECODE_PLAYERSTATE) {
+            bool needVehicle = (vehicleStatus == VEHICLE_INSIDE)
+                || snap->getPlayerstate()->hasVehicleSet();
+
+            if (needVehicle != (snap->getVehiclestate() != 0)) {
+                //decoded without exception, but with wrong vehicle guess
+                impl->decode(vehicleStatus == VEHICLE_INSIDE);
+            }
+        }
+    }
+    catch (std::exception&) {
+        //message cant be decoded with any vehicle variant, demo is corrupted
+        Message::forceVehicleLoad = false;
+        Message::decodeDepth = DECODE_FULL;
+        Message::projection = 0;
+        impl->message.clear();
+        impl->corrupted = true;
+        return false;
+    }
+
+    Message::forceVehicleLoad = false;
+    Message::decodeDepth = DECODE_FULL;
+    Message::projection = 0;
+
+    impl->history[seqNumber & PACKET_MASK].seqNumber = seqNumber;
+    impl->history[seqNumber & PACKET_MASK].vehicleStatus = vehicleStatus;
+    impl->lastVehicleStatus = vehicleStatus;
+
+    ++impl->count;
+
+    return true;
+}
+
+Message* DemoReader::getMessage() {
+    if (!impl->message.isLoad())
+        return 0;
+
+    return &impl->message;
+}
+
+void DemoReader::setProjection(Projection* projection) {
+    impl->projection = projection;
+}
+
+void DemoReader::setDecodeDepth(int depth) {
+    assert(depth >= DECODE_COMMANDS && depth <= DECODE_FULL);
+    impl->depth = depth;
+}
+
+int DemoReader::getMessageCount() const {
+    return impl->count;
+}
+
+long long DemoReader::getBytesRead() const {
+    return impl->bytesRead;
+}
+
+bool DemoReader::isCorrupted() const {
+    return impl->corrupted;
+}
+
+DEMO_NAMESPACE_END
@@ -0,0 +1,104 @@
+#ifndef DEMOREADER_H
+#define DEMOREADER_H
+
+#include "message.h"
+
+DEMO_NAMESPACE_START
+
+class DemoReaderImpl;
+
+/*
+Forward-only reader of demo files. Unlike Demo it doesnt build any index
+and doesnt keep loaded messages, there is only one message object which
+is reused for every read, so memory needed is constant no matter how long
+the demo is. Source can be any input stream, including pipes (stdin).
+
+Vehicle status needed for correct snapshot loading is tracked on the fly
+from the last 32 messages, so no analysis pass is needed.
+
+Typical use:
+
+    DemoReader reader;
+    reader.open("-"); //standard input
+    while (reader.next()) {
+        Message* message = reader.getMessage();
+        ...
+    }
+*/
+class DemoReader
+{
+private:
+    DemoReaderImpl* impl;
+
+    //no copying, reader owns its stream and message
+    DemoReader(const DemoReader&);
+    DemoReader& operator=(const DemoReader&);
+
+public:
+
+    DemoReader();
+    ~DemoReader();
+
+    /*
+    Opens demo file with given name for reading. Name "-" stands for
+    standard input.
+    */
+    bool open(const char* filename);
+
+    /*
+    Reads demo from already opened stream. Stream must be opened in binary
+    mode and must stay valid until reader is closed.
+    */
+    bool open(std::istream& is);
+
+    bool isOpen() const;
+
+    void close();
+
+    /*
+    Reads and decodes next message. Returns false on the end of the demo
+    (proper ending, end of stream or truncated message) and on message which
+    cant be decoded (corrupted demo), nothing is thrown.
+    */
+    bool next();
+
+    /*
+    Returns message decoded by last call of next(). Message is owned by
+    reader and its content is replaced by next call of next().
+    */
+    Message* getMessage();
+
+    /*
+    Sets projection used for decoding of following messages (see Projection).
+    Projection isnt copied, it must stay valid while it is set, 0 turns it off.
+    */
+    void setProjection(Projection* projection);
+
+    /*
+    Sets how deep following messages are decoded (see Message::decodeDepth),
+    DECODE_FULL by default. DECODE_COMMANDS reads only server commands, rest
+    of the message after them isnt decoded at all, DECODE_GAMESTATE reads
+    gamestates too. Partially decoded messages cant be saved.
+    */
+    void setDecodeDepth(int depth);
+
+    /*
+    Returns number of messages successfully read so far.
+    */
+    int getMessageCount() const;
+
+    /*
+    Returns number of bytes consumed from input so far.
+    */
+    long long getBytesRead() const;
+
+    /*
+    Returns true when next() returned false because of message which cant
+    be decoded (see next()), truncated demo isnt taken as corrupted.
+    */
+    bool isCorrupted() const;
+};
+
+DEMO_NAMESPACE_END
+
+#endif
@@ -0,0 +1,157 @@
+#include "entityfilter.h"
+#include "message.h"
+
+DEMO_NAMESPACE_START
+
+enum {
+    ENTITY_ETYPE = 8    //EntitySchema index
+};
+
+static const char* typeNames[ET_EVENTS + 1] = {
+    "general", "player", "item", "missile", "special", "holocron", "mover",
+    "beam", "portal", "speaker", "push_trigger", "teleport_trigger",
+    "invisible", "npc", "team", "body", "terrain", "fx", "events"
+};
+
+//bits entity takes in message, with its number
+static int getEntityBits(int number, const EntityState& entity) {
+    MessageBuffer::Counter counter(Message::buffer);
+    Message::buffer.writeBits(number, SIZE_ENTITY_BITS);
+    entity.save();
+    return counter.getBits();
+}
+
+EntityFilter::EntityFilter() : predicate(0) {
+    for (int i = 0; i < MAX_GENTITIES; ++i)
+        lastClass[i] = -1;
+
+    for (int i = 0; i <= ET_EVENTS; ++i) {
+        baselineBits[i] = 0;
+        snapshotBits[i] = 0;
+        dropped[i] = 0;
+    }
+}
+
+int EntityFilter::getTypeByName(const std::string& name) {
+    for (int i = 0; i <= ET_EVENTS; ++i)
+        if (name == typeNames[i])
+            return i;
+
+    return -1;
+}
+
+const char* EntityFilter::getTypeName(int eType) {
+    return typeNames[getClass(eType)];
+}
+
+int EntityFilter::getClass(int eType) {
+    if (eType < 0)
+        return ET_GENERAL;
+
+    return (eType < ET_EVENTS) ? eType : ET_EVENTS;
+}
+
+void EntityFilter::dropType(int eType) {
+    types.set(getClass(eType));
+}
+
+void EntityFilter::dropRange(int first, int last) {
+    if (first < 0 || last >= MAX_GENTITIES || first > last)
+        throw DemoException("entity number range out of bounds");
+
+    ranges.push_back(std::make_pair(first, last));
+}
+
+void EntityFilter::setPredicate(EntityPredicate* predicate) {
+    this->predicate = predicate;
+}
+
+bool EntityFilter::isEmpty() const {
+    return types.none() && ranges.empty() && !predicate;
+}
+
+bool EntityFilter::isDropped(int number, const EntityState& entity) const {
+    if (types[getClass(entity.getAtributeInt(ENTITY_ETYPE))])
+        return true;
+
+    for (int i = 0; i < (int)ranges.size(); ++i)
+        if (number >= ranges[i].first && number <= ranges[i].second)
+            return true;
+
+    return predicate && predicate->isDropped(number, entity);
+}
+
+void EntityFilter::filter(Gamestate* gamestate) {
+    const std::map<int, EntityState>& baselines = gamestate->getBaseEntities();
+    std::vector<int> numbers;
+
+    for (std::map<int, EntityState>::const_iterator it = baselines.begin(); it != baselines.end(); ++it) {
+        if (!isDropped(it->first, it->second))
+            continue;
+
+        int cls = getClass(it->second.getAtributeInt(ENTITY_ETYPE));
+        baselineBits[cls] += MessageBuffer::getBitsLength(svc_baseline, SIZE_8BITS)
+            + getEntityBits(it->first, it->second);
+        numbers.push_back(it->first);
+    }
+
+    for (int i = 0; i < (int)numbers.size(); ++i)
+        gamestate->removeBaseEntity(numbers[i]);
+}
+
+void EntityFilter::filter(Snapshot* snapshot) {
+    std::map<int, EntityState>& entities = snapshot->getEntities();
+
+    for (std::map<int, EntityState>::iterator it = entities.begin(); it != entities.end();) {
+        if (isDropped(it->first, it->second))
+            entities.erase(it++);
+        else
+            ++it;
+    }
+}
+
+void EntityFilter::count(Snapshot* full, Snapshot* encoded) {
+    std::map<int, EntityState>& fullEntities = full->getEntities();
+    std::map<int, EntityState>& entities = encoded->getEntities();
+
+    for (std::map<int, EntityState>::iterator it = entities.begin(); it != entities.end(); ++it) {
+        std::map<int, EntityState>::iterator state = fullEntities.find(it->first);
+        int cls;
+
+        if (state == fullEntities.end()) {
+            //removed, it was dropped when it was sent last time
+            cls = lastClass[it->first];
+        }
+        else {
+            cls = isDropped(state->first, state->second)
+                ? getClass(state->second.getAtributeInt(ENTITY_ETYPE)) : -1;
+        }
+
+        if (cls >= 0)
+            snapshotBits[cls] += getEntityBits(it->first, it->second);
+    }
+
+    for (int i = 0; i < MAX_GENTITIES; ++i)
+        lastClass[i] = -1;
+
+    for (std::map<int, EntityState>::iterator it = fullEntities.begin(); it != fullEntities.end(); ++it) {
+        if (!isDropped(it->first, it->second))
+            continue;
+
+        lastClass[it->first] = getClass(it->second.getAtributeInt(ENTITY_ETYPE));
+        ++dropped[lastClass[it->first]];
+    }
+}
+
+void EntityFilter::report(std::ostream& os) const {
+    for (int i = 0; i <= ET_EVENTS; ++i) {
+        if (!dropped[i] && !baselineBits[i])
+            continue;
+
+        os << typeNames[i] << ": " << dropped[i] << " dropped in snapshots, "
+            << (baselineBits[i] + snapshotBits[i]) / 8 << " bytes saved ("
+            << baselineBits[i] / 8 << " in baselines)" << std::endl;
+    }
+}
+
+DEMO_NAMESPACE_END
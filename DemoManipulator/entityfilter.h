@@ -0,0 +1,106 @@
+#ifndef ENTITYFILTER_H
+#define ENTITYFILTER_H
+
+#include "instruction.h"
+
+DEMO_NAMESPACE_START
+
+//JKA entity types (bg_public.h), temporary event entity has eType ET_EVENTS + event
+enum ENTITY_TYPE {
+    ET_GENERAL,
+    ET_PLAYER,
+    ET_ITEM,
+    ET_MISSILE,
+    ET_SPECIAL,
+    ET_HOLOCRON,
+    ET_MOVER,
+    ET_BEAM,
+    ET_PORTAL,
+    ET_SPEAKER,
+    ET_PUSH_TRIGGER,
+    ET_TELEPORT_TRIGGER,
+    ET_INVISIBLE,
+    ET_NPC,
+    ET_TEAM,
+    ET_BODY,
+    ET_TERRAIN,
+    ET_FX,
+    ET_EVENTS
+};
+
+/*
+Custom rule for EntityFilter, entity is the full state (see Snapshot::makeInit()).
+*/
+class EntityPredicate {
+public:
+    virtual ~EntityPredicate() {};
+
+    virtual bool isDropped(int number, const EntityState& entity) const = 0;
+};
+
+/*
+Strips entities from full snapshots and gamestate baselines, so demo keeps
+only what is needed (e.g. players and items of POV demo). Entity is dropped
+by its class (eType, all event types are one class), by its number or by
+custom predicate. Entity is judged by its current state, so reused number
+can be dropped in one snapshot and kept in other one.
+
+Filtered snapshots must be encoded again (see SnapshotEncoder), the encoder
+has to be reset with the filtered gamestate, as client reads new entities
+as delta from baselines which are left in it.
+
+Bits of dropped entities are counted by class for the report.
+*/
+class EntityFilter
+{
+private:
+    std::bitset<ET_EVENTS + 1>          types;
+    std::vector<std::pair<int, int> >   ranges;
+    EntityPredicate*                    predicate;
+
+    //class of entity numbers in last counted snapshot, -1 when not present
+    short   lastClass[MAX_GENTITIES];
+
+    long long   baselineBits[ET_EVENTS + 1];
+    long long   snapshotBits[ET_EVENTS + 1];
+    int         dropped[ET_EVENTS + 1];
+
+public:
+    EntityFilter();
+
+    //lowercase name without ET_ ("missile", "events"), -1 for unknown name
+    static int getTypeByName(const std::string& name);
+    static const char* getTypeName(int eType);
+
+    //class of entity type, events are ET_EVENTS
+    static int getClass(int eType);
+
+    void dropType(int eType);
+    void dropRange(int first, int last);
+
+    //predicate isnt copied, it must stay valid while it is set, 0 turns it off
+    void setPredicate(EntityPredicate* predicate);
+
+    bool isEmpty() const;
+
+    bool isDropped(int number, const EntityState& entity) const;
+
+    //removes dropped baselines, gamestate must be given to SnapshotHistory before
+    void filter(Gamestate* gamestate);
+
+    //removes dropped entities from full snapshot
+    void filter(Snapshot* snapshot);
+
+    /*
+    Counts bits of entities dropped from full snapshot in its encoded form
+    without filtering (see SnapshotEncoder), both of the same message.
+    */
+    void count(Snapshot* full, Snapshot* encoded);
+
+    //one line per class with something dropped: entities and bytes saved
+    void report(std::ostream& os) const;
+};
+
+DEMO_NAMESPACE_END
+
+#endif
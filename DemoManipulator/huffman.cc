@@ -471,6 +471,10 @@ void MessageBuffer::Huffman::addRef(HuffmanManipulator& huff, byte ch) {
 MessageBuffer::Huffman::Huffman() : initialized(false) {
     memset(&compressor, 0, sizeof(HuffmanManipulator));
     memset(&decompressor, 0, sizeof(HuffmanManipulator));
+
+    //trees are only read after initialization, building them
+    //before main() makes them safe to share between threads
+    init();
 }
 
 void MessageBuffer::Huffman::init() {
@@ -499,6 +503,13 @@ void MessageBuffer::Huffman::init() {
         }
     }
 
+    //code of symbol is path from its leaf to the root
+    for (int i = 0; i < HMAX; i++) {
+        codeLength[i] = 0;
+        for (Node* node = compressor.loc[i]; node && node->parent; node = node->parent)
+            ++codeLength[i];
+    }
+
     initialized = true;
 }
 
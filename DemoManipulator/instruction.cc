@@ -8,6 +8,10 @@ Instruction Implementation
 
 */
 
+Instruction* Instruction::clone() {
+    return new Instruction(*this);
+}
+
 void Instruction::Save()  const {
 }
 
@@ -18,6 +22,13 @@ void Instruction::report(std::ostream& os) const {
     os << "*INSTRUCTION: Base Instruction (shouldnt happen)" << std::endl << std::endl;
 }
 
+int Instruction::getBitLength() const {
+    MessageBuffer::Counter counter(Message::buffer);
+    Save();
+
+    return counter.getBits();
+}
+
 /*
 
 Instruction CONVERTING METHODS
@@ -58,6 +69,10 @@ ServerCommand Implementation
 
 */
 
+ServerCommand* ServerCommand::clone() {
+    return new ServerCommand(*this);
+}
+
 void ServerCommand::Save() const {
     Message::buffer.writeBits(svc_serverCommand, SIZE_8BITS);
     Message::buffer.writeBits(sequenceNumber, SIZE_32BITS);
@@ -69,6 +84,38 @@ void ServerCommand::Load() {
     command = Message::buffer.readString(true);
 }
 
+int ServerCommand::getConfigstring(int* index, std::string* value) const {
+    int type;
+
+    if (command.compare(0, 3, "cs ") == 0)
+        type = CONFIGSTRING_SET;
+    else if (command.compare(0, 5, "bcs0 ") == 0)
+        type = CONFIGSTRING_BIG_BEGIN;
+    else if (command.compare(0, 5, "bcs1 ") == 0)
+        type = CONFIGSTRING_BIG_PART;
+    else if (command.compare(0, 5, "bcs2 ") == 0)
+        type = CONFIGSTRING_BIG_END;
+    else
+        return CONFIGSTRING_NONE;
+
+    //<name> <index> "<value>"
+    size_t start = command.find_first_of(' ') + 1;
+    if (index)
+        *index = atoi(command.c_str() + start);
+
+    start = command.find_first_of('"', start);
+    size_t end = command.find_first_of('"', start + 1);
+
+    if (value) {
+        if (start == std::string::npos)
+            value->clear();
+        else
+            *value = command.substr(start + 1, end - start - 1);
+    }
+
+    return type;
+}
+
 void ServerCommand::report(std::ostream& os) const {
     std::string s = command;
 
@@ -86,12 +133,34 @@ Snapshot* Snapshot::clone() {
     Snapshot* snap = new Snapshot(*this);
 
     snap->playerState = playerState->clone();
-    snap->vehicleState = 0; //make clone for vehicle states too!
+    snap->vehicleState = vehicleState ? vehicleState->clone() : 0;
     snap->entities = this->entities;
 
     return snap;
 }
 
+static void assignState(PlayerState*& state, PlayerState* source) {
+    if (state && source && state->getType() == source->getType()) {
+        state->assign(source);
+        return;
+    }
+
+    delete state;
+    state = source ? source->clone() : 0;
+}
+
+void Snapshot::assign(Snapshot* snap) {
+    serverTime = snap->serverTime;
+    deltaNum = snap->deltaNum;
+    flags = snap->flags;
+    areaMask = snap->areaMask;
+
+    assignState(playerState, snap->playerState);
+    assignState(vehicleState, snap->vehicleState);
+
+    entities = snap->entities;
+}
+
 Snapshot::~Snapshot() {
     if (playerState)
         delete playerState;
@@ -142,6 +211,12 @@ void Snapshot::Load() {
         it != areaMask.end(); ++it)
         *it = Message::buffer.readBits(SIZE_8BITS);
 
+    if (Message::decodeDepth == DECODE_HEADER) {
+        //caller wants only header, but we still need valid playerstate object
+        playerState = new PlayerState();
+        return;
+    }
+
     if (!Message::buffer.readBits(SIZE_1BIT))
         playerState = new PlayerState();
     else
@@ -154,6 +229,9 @@ void Snapshot::Load() {
         vehicleState->load();
     }
 
+    if (Message::decodeDepth == DECODE_PLAYERSTATE)
+        return;
+
     int testnumber;
     for (int i = 0; i < 1024; ++i) {
         testnumber = Message::buffer.readBits(SIZE_ENTITY_BITS);
@@ -164,7 +242,16 @@ void Snapshot::Load() {
         if (testnumber < 0 || testnumber >= MAX_GENTITIES)
             throw DemoException("entity number out of range");
         //throw "entity number out of range";
-        entities[testnumber].load();
+        if (!Message::projection) {
+            entities[testnumber].load();
+            continue;
+        }
+
+        //entities filtered out by projection are read but not stored
+        EntityState entity;
+        entity.load();
+        if (Message::projection->filterEntity(testnumber, entity))
+            entities[testnumber] = entity;
     }
 }
 
@@ -277,6 +364,16 @@ void Snapshot::applyOn(Snapshot* snap) {
 
 }
 
+int Snapshot::getEntitiesCount() const {
+    int count = 0;
+
+    for (entitymap_cit it = entities.begin(); it != entities.end(); ++it)
+        if (!it->second.isRemoved())
+            ++count;
+
+    return count;
+}
+
 void Snapshot::makeInit() {
     playerState->removeNull();
 
@@ -314,6 +411,10 @@ Gamestate Implementation
 
 */
 
+Gamestate* Gamestate::clone() {
+    return new Gamestate(*this);
+}
+
 void Gamestate::Save() const {
     Message::buffer.writeBits(svc_gamestate, SIZE_8BITS);
     Message::buffer.writeBits(commandSequence, SIZE_32BITS);
@@ -376,6 +477,10 @@ void Gamestate::Load() {
     //server command sequence
     commandSequence = Message::buffer.readBits(SIZE_32BITS);
 
+    //entity numbers are reused on new map
+    if (Message::projection)
+        Message::projection->resetEntityTypes();
+
     int cmd;
     while (true) {
         cmd = Message::buffer.readBits(SIZE_8BITS);
@@ -397,7 +502,15 @@ void Gamestate::Load() {
             if (newnum < 0 || newnum >= MAX_GENTITIES)
                 throw DemoException("entity number out of range");
 
-            baseEntities[newnum].load();
+            if (!Message::projection) {
+                baseEntities[newnum].load();
+                continue;
+            }
+
+            EntityState entity;
+            entity.load();
+            if (Message::projection->filterBaseline(newnum, entity))
+                baseEntities[newnum] = entity;
         }
         else {
             throw DemoException("unknown message type (inside gamestate)");
@@ -480,6 +593,10 @@ void Gamestate::removeConfigstring(int id) {
     }
 }
 
+void Gamestate::removeBaseEntity(int number) {
+    baseEntities.erase(number);
+}
+
 std::string Gamestate::getMagicStuff() {
     return magicStuff;
 }
@@ -528,21 +645,34 @@ void Gamestate::setMagicData(unsigned id, int byte1, int byte2, int int1, int in
     magicData[id].int2 = int2;
 }
 
+void Gamestate::setConfigstrings(const std::map<int, std::string>& strings) {
+    configStrings = strings;
+}
+
 void Gamestate::update(const ServerCommand* servercommand) {
     assert(servercommand);
 
-    const std::string command = servercommand->getCommand();
-    if (command.find("cs ") == 0) {
-        int i;
-
-        int start = (int)command.find_first_of(' ', 3);
-        std::stringstream stream(command.substr(3, start - 3));
-        stream >> i;
-
-        start = (int)command.find_first_of('"', start);
-        int end = (int)command.find_first_of('"', start + 1);
-
-        setConfigstring(i, command.substr(start + 1, end - start - 1));
+    int i;
+    std::string value;
+
+    switch (servercommand->getConfigstring(&i, &value)) {
+    case CONFIGSTRING_SET:
+        setConfigstring(i, value);
+        break;
+    case CONFIGSTRING_BIG_BEGIN:
+        bigIndex = i;
+        bigValue = value;
+        break;
+    case CONFIGSTRING_BIG_PART:
+        if (i == bigIndex)
+            bigValue += value;
+        break;
+    case CONFIGSTRING_BIG_END:
+        if (i == bigIndex)
+            setConfigstring(i, bigValue + value);
+        bigIndex = -1;
+        bigValue.clear();
+        break;
     }
 }
 
@@ -552,6 +682,10 @@ MapChange Implementation
 
 */
 
+MapChange* MapChange::clone() {
+    return new MapChange(*this);
+}
+
 void MapChange::Save() const {
     Message::buffer.writeBits(svc_mapchange, SIZE_8BITS);
 }
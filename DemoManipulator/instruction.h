@@ -35,11 +35,20 @@ public:
     Instruction(int type = INSTR_BASE) : type(type) {};
     virtual	~Instruction() {};
 
+    //clone
+    virtual Instruction* clone();
+
     //I/O methods
     virtual void Save()  const;
     virtual void Load();
     virtual void report(std::ostream& os) const;
 
+    /*
+    Gives exact number of bits instruction takes in message, nothing is
+    written (see MessageBuffer::Counter).
+    */
+    int getBitLength() const;
+
     //get methods
     int getType() const { return type; };
 
@@ -60,11 +69,23 @@ private:
 public:
     MapChange() : Instruction(INSTR_MAPCHANGE) {};
 
+    //clone
+    MapChange* clone();
+
     //I/O methods
     void Save() const;
     void report(std::ostream& os) const;
 };
 
+//configstring server commands, see ServerCommand::getConfigstring
+enum {
+    CONFIGSTRING_NONE = 0,  //not a configstring command
+    CONFIGSTRING_SET,       //cs, whole configstring
+    CONFIGSTRING_BIG_BEGIN, //bcs0, first part of big configstring
+    CONFIGSTRING_BIG_PART,  //bcs1, middle part
+    CONFIGSTRING_BIG_END,   //bcs2, last part, configstring is complete
+};
+
 class ServerCommand : public Instruction {
 private:
     int         sequenceNumber;
@@ -73,6 +94,9 @@ private:
 public:
     ServerCommand() : Instruction(INSTR_SERVERCOMMAND) {};
 
+    //clone
+    ServerCommand* clone();
+
     //I/O methods
     void Save() const;
     void Load();
@@ -80,6 +104,16 @@ public:
 
     int getSequenceNumber() const { return sequenceNumber; };
     std::string getCommand() const { return command; };
+
+    //empty command is ignored by client, sequence number is kept
+    void setCommand(const std::string& s) { command = s; };
+
+    /*
+    Parses configstring command (cs, bcs0, bcs1, bcs2). Returns one of
+    CONFIGSTRING_ values, index and value are set only for configstring commands.
+    Big configstrings are split to several commands, value holds only one part.
+    */
+    int getConfigstring(int* index, std::string* value) const;
 };
 
 class PlayerState;
@@ -103,6 +137,10 @@ public:
     //clone
     Snapshot* clone();
 
+    //copies whole snapshot into this one, already allocated states and
+    //entities are reused, so snapshot kept over time isnt allocated again
+    void assign(Snapshot* snap);
+
     //I/O methods
     void Save() const;
     void Load();
@@ -117,6 +155,9 @@ public:
     PlayerState* getPlayerstate() { return playerState; };
     PlayerState* getVehiclestate() { return vehicleState; };
 
+    //entities which are not removed, client parses that many for full snapshot
+    int getEntitiesCount() const;
+
     //set methods
     void setAreamask(int id, int value) { areaMask[id] = value; };
     void setAreamaskLen(int value) { areaMask.resize(value); };
@@ -164,11 +205,17 @@ protected:
     entitymap baseEntities;
     stringmap configStrings;
 
+    //big configstring being assembled from bcs commands
+    int         bigIndex;
+    std::string bigValue;
 
 public:
     Gamestate() : Instruction(INSTR_GAMESTATE),
         commandSequence(0), clientNumber(0),
-        checksumFeed(0), magicSeed(0) {};
+        checksumFeed(0), magicSeed(0), bigIndex(-1) {};
+
+    //clone
+    Gamestate* clone();
 
     //I/O methods
     void Save() const;
@@ -177,6 +224,9 @@ public:
 
     //get methods
     std::string getConfigstring(int id);
+    int getCommandSequence() const { return commandSequence; };
+    const std::map<int, std::string>& getConfigstrings() const { return configStrings; };
+    const std::map<int, EntityState>& getBaseEntities() const { return baseEntities; };
     std::string getMagicStuff();
     int getMagicSeed();
     int getMagicDataCount();
@@ -184,11 +234,13 @@ public:
 
     //set methods
     void setConfigstring(int id, const std::string& s);
+    void setConfigstrings(const std::map<int, std::string>& strings);
     void setMagicStuff(const std::string& s);
     void setMagicSeed(int seed);
     void setMagicData(unsigned id, int byte1, int byte2, int int1, int int2);
 
     void removeConfigstring(int id);
+    void removeBaseEntity(int number);
 
     //load new things from server message
     void update(const ServerCommand* servercommand);
@@ -4,8 +4,10 @@
 
 DEMO_NAMESPACE_START
 
-bool Message::forceVehicleLoad = false;
-MessageBuffer Message::buffer;
+thread_local bool Message::forceVehicleLoad = false;
+thread_local int Message::decodeDepth = DECODE_FULL;
+thread_local Projection* Message::projection = 0;
+thread_local MessageBuffer Message::buffer;
 
 class MessageImpl {
 public:
@@ -13,11 +15,13 @@ public:
     int  sequenceNumber;
     int  reliableAcknowledge;
     bool loaded;
+    int  depth;
+    bool projected;
 
     std::vector<Instruction*> instructions;
 };
 
-void Message::load(std::ifstream& is) {
+void Message::load(std::istream& is) {
     int msglen;
 
     is.read((char*)&(impl->sequenceNumber), sizeof(impl->sequenceNumber));
@@ -30,6 +34,10 @@ void Message::load(std::ifstream& is) {
     //which knows how to read it
     Message::buffer.load(is, msglen);
 
+    decode();
+}
+
+void Message::decode() {
     try {
 
         impl->reliableAcknowledge = Message::buffer.readBits(SIZE_32BITS);
@@ -49,9 +57,17 @@ void Message::load(std::ifstream& is) {
             case svc_nop:
                 break;
             case svc_snapshot:
+                if (Message::decodeDepth < DECODE_HEADER) {
+                    cmd = svc_EOF; //caller doesnt want snapshots, nothing else follows
+                    break;
+                }
+
                 tmpInstr = new Snapshot();
                 tmpInstr->Load();
                 impl->instructions.push_back(tmpInstr);
+
+                if (Message::decodeDepth < DECODE_FULL)
+                    cmd = svc_EOF; //rest of the snapshot wasnt read, cant continue
                 break;
             case svc_serverCommand:
                 tmpInstr = new ServerCommand();
@@ -59,6 +75,11 @@ void Message::load(std::ifstream& is) {
                 impl->instructions.push_back(tmpInstr);
                 break;
             case svc_gamestate:
+                if (Message::decodeDepth == DECODE_COMMANDS) {
+                    cmd = svc_EOF; //gamestate is always last in message
+                    break;
+                }
+
                 tmpInstr = new Gamestate();
                 tmpInstr->Load();
                 impl->instructions.push_back(tmpInstr);
@@ -71,6 +92,9 @@ void Message::load(std::ifstream& is) {
                 throw DemoException("unknown message type");
                 break;
             }
+
+            if (cmd == svc_EOF)
+                break;
         }
     }
     catch (std::exception& e) {
@@ -79,12 +103,12 @@ void Message::load(std::ifstream& is) {
     }
 
     impl->loaded = true; //successfully loaded
+    impl->depth = Message::decodeDepth;
+    impl->projected = (Message::projection != 0);
     Message::buffer.clean();
 }
 
-void Message::save(std::ofstream& os) const {
-    Message::buffer.clean();
-
+void Message::encode() const {
     Message::buffer.writeBits(impl->reliableAcknowledge, SIZE_32BITS);
 
     for (std::vector<Instruction*>::const_iterator it = impl->instructions.begin();
@@ -92,6 +116,14 @@ void Message::save(std::ofstream& os) const {
         (*it)->Save();
     }
     Message::buffer.writeBits(svc_EOF, SIZE_8BITS);
+}
+
+void Message::save(std::ostream& os) const {
+    if (impl->depth < DECODE_FULL || impl->projected)
+        throw DemoException("partially loaded message cant be saved");
+
+    Message::buffer.clean();
+    encode();
 
     os.write((char*)&(impl->sequenceNumber), sizeof(impl->sequenceNumber));
     os.write((char*)&(Message::buffer.length), sizeof(Message::buffer.length));
@@ -100,10 +132,39 @@ void Message::save(std::ofstream& os) const {
     Message::buffer.clean();
 }
 
+int Message::getBitLength() const {
+    if (impl->depth < DECODE_FULL || impl->projected)
+        throw DemoException("partially loaded message cant be measured");
+
+    MessageBuffer::Counter counter(Message::buffer);
+    encode();
+
+    return counter.getBits();
+}
+
 Message::Message() : impl(new MessageImpl()) {
     impl->loaded = false;
+    impl->depth = DECODE_FULL;
+    impl->projected = false;
 };
 
+Message* Message::clone() const {
+    Message* message = new Message();
+
+    *(message->impl) = *impl;
+
+    for (std::vector<Instruction*>::iterator it = message->impl->instructions.begin();
+        it != message->impl->instructions.end(); ++it) {
+        *it = (*it)->clone();
+    }
+
+    return message;
+}
+
+void Message::swap(Message& other) {
+    std::swap(impl, other.impl);
+}
+
 Message::~Message() {
 
     for (std::vector<Instruction*>::iterator it = impl->instructions.begin();
@@ -118,6 +179,14 @@ bool Message::isLoad() const {
     return impl->loaded;
 };
 
+int Message::getDecodeDepth() const {
+    return impl->depth;
+};
+
+bool Message::isProjected() const {
+    return impl->projected;
+};
+
 void Message::setSeqNumber(int seq) {
     impl->sequenceNumber = seq;
 };
@@ -157,16 +226,25 @@ void Message::deleteInstruction(int id, int n) {
         impl->instructions.begin() + id + n);
 }
 
+void Message::insertInstruction(int id, Instruction* instruction) {
+    assert((id >= 0) && (id <= (int)impl->instructions.size()));
+    assert(instruction);
+
+    impl->instructions.insert(impl->instructions.begin() + id, instruction);
+}
+
 void Message::clear() {
     for (int i = 0; i < (int)impl->instructions.size(); ++i) {
         delete impl->instructions[i];
     }
 
     impl->instructions.clear();
+    impl->loaded = false;
+    impl->projected = false;
 }
 
-bool Message::saveMessage(std::ofstream& os) const {
-    if (!impl->loaded)
+bool Message::saveMessage(std::ostream& os) const {
+    if (!impl->loaded || impl->depth < DECODE_FULL || impl->projected)
         return false;
 
     save(os);
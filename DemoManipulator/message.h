@@ -9,17 +9,26 @@ class Instruction;
 
 class MessageImpl;
 class MessageBuffer;
+class Projection;
 
 class Message
 {
     friend class Demo;
     friend class DemoImpl;
+    friend class DemoReader;
+    friend class DemoReaderImpl;
 
 private:
     MessageImpl* impl;
 
-    void load(std::ifstream& is);
-    void save(std::ofstream& os) const;
+    void load(std::istream& is);
+    void save(std::ostream& os) const;
+
+    //decodes content of shared buffer, which must be already filled
+    void decode();
+
+    //writes content of message to shared buffer, counterpart of decode()
+    void encode() const;
 
 public:
 
@@ -29,17 +38,39 @@ public:
     //still using shared buffer
     //Demo::Loader with access only from class Demo
     //and will be friend to both Instruction and State
-    static MessageBuffer buffer;
+    //decoding state is kept per thread, so demos can be decoded
+    //in parallel, each thread with its own Demo or DemoReader
+    static thread_local MessageBuffer buffer;
 
     Message();
     ~Message();
 
+    //deep copy of message, copy is owned by caller
+    Message* clone() const;
+
+    //exchanges content with other message, nothing is copied
+    void swap(Message& other);
+
     void clear();
 
-    static bool forceVehicleLoad;
+    static thread_local bool forceVehicleLoad;
+
+    //depth used for decoding, when less than DECODE_FULL, decoding
+    //of message stops in first snapshot, below DECODE_HEADER it stops
+    //before it (and before gamestate for DECODE_COMMANDS)
+    static thread_local int decodeDepth;
+
+    //when set, only fields selected by projection are stored while decoding
+    static thread_local Projection* projection;
 
     bool isLoad() const;
 
+    //partially loaded messages (see decodeDepth) cant be saved
+    int getDecodeDepth() const;
+
+    //messages decoded with projection are incomplete and cant be saved
+    bool isProjected() const;
+
     void setSeqNumber(int seq);
     void setRelAcknowledge(int rel);
 
@@ -52,7 +83,18 @@ public:
     //delete instructions in range [id,endid)
     void deleteInstruction(int id, int n = 1);
 
-    bool saveMessage(std::ofstream& os) const;
+    //inserts instruction before instruction id (id equal to count appends it),
+    //message takes ownership of the instruction
+    void insertInstruction(int id, Instruction* instruction);
+
+    bool saveMessage(std::ostream& os) const;
+
+    /*
+    Gives exact number of bits of message content (acknowledge, instructions
+    and end mark), nothing is written. Message takes (bits >> 3) + 1 bytes
+    plus 8 bytes of header (sequence number and length) in demo file.
+    */
+    int getBitLength() const;
 };
 
 DEMO_NAMESPACE_END
@@ -2,24 +2,33 @@
 
 DEMO_NAMESPACE_START
 
-MessageBuffer::MessageBuffer() : currentPosition(0), length(0) {
+MessageBuffer::MessageBuffer() : currentPosition(0), length(0), counting(false), countedBits(0) {
 }
 
 void MessageBuffer::clean() {
     currentPosition = length = 0;
 }
 
-void MessageBuffer::save(std::ofstream& dest) {
+void MessageBuffer::save(std::ostream& dest) {
     dest.write((char*)&buffer, length);
 }
 
-void MessageBuffer::load(std::ifstream& source, int len) {
+void MessageBuffer::load(std::istream& source, int len) {
     clean();
+
+    if (len < 0 || len > MAX_MSGLEN)
+        throw DemoException("message length out of range");
+
     source.read((char*)&buffer, len);
     length = len;
 }
 
 void MessageBuffer::writeBits(int value, int bitSize) {
+    if (counting) {
+        countedBits += getBitsLength(value, bitSize);
+        return;
+    }
+
     if (bitSize < 0) {
         bitSize = -bitSize;
     }
@@ -104,6 +113,35 @@ std::string MessageBuffer::readString(bool big = false) {
     return str;
 }
 
+MessageBuffer::Counter::Counter(MessageBuffer& msgbuff)
+    : msgbuff(msgbuff), wasCounting(msgbuff.counting), previousBits(msgbuff.countedBits) {
+    msgbuff.counting = true;
+    msgbuff.countedBits = 0;
+}
+
+MessageBuffer::Counter::~Counter() {
+    msgbuff.counting = wasCounting;
+    msgbuff.countedBits = previousBits;
+}
+
+int MessageBuffer::getBitsLength(int value, int bitSize) {
+    if (bitSize < 0) {
+        bitSize = -bitSize;
+    }
+
+    //same split as writeBits(), raw bits first, then Huffman coded bytes
+    value &= (0xffffffff >> (32 - bitSize));
+    int bits = bitSize & 7;
+    value >>= bits;
+
+    for (int i = bits; i < bitSize; i += 8) {
+        bits += huffman.getCodeLength(value & 0xff);
+        value >>= 8;
+    }
+
+    return bits;
+}
+
 void MessageBuffer::initHuffman() {
     MessageBuffer::huffman.init();
 }
@@ -19,14 +19,22 @@ private:
     int     currentPosition;
     int     length;
 
+    bool    counting;
+    int     countedBits;
+
     static  Huffman huffman;
 
 public:
     MessageBuffer();
 
+    /*
+    Resets position and length only, loaded data stay in buffer until next
+    load(), so the message can be decoded again after failed attempt
+    (DemoReader::next() retries with other vehicle guess).
+    */
     void clean();
-    void load(std::ifstream& source, int len);
-    void save(std::ofstream& dest);
+    void load(std::istream& source, int len);
+    void save(std::ostream& dest);
 
     int readBits(int bitSize);
     std::string readString(bool big);
@@ -34,6 +42,31 @@ public:
     void writeBits(int value, int bitSize);
     void writeString(const std::string& s, bool big);
 
+    /*
+    While counter exists, nothing is written to the buffer, writeBits() and
+    writeString() only add encoded length of the data to it, so size of
+    anything can be found out by saving it. Lengths are taken from table of
+    Huffman code lengths. Buffer content and position are not touched and
+    previous counting is restored when counter ends, so counters can be nested.
+    */
+    class Counter {
+    private:
+        MessageBuffer&  msgbuff;
+        bool            wasCounting;
+        int             previousBits;
+
+    public:
+        Counter(MessageBuffer& msgbuff);
+        ~Counter();
+
+        int getBits() const { return msgbuff.countedBits; };
+    };
+
+    /*
+    Gives number of bits which writeBits() would write.
+    */
+    static int getBitsLength(int value, int bitSize);
+
     static void initHuffman();
 };
 
@@ -67,6 +100,8 @@ private:
     HuffmanManipulator compressor;
     HuffmanManipulator decompressor;
 
+    int codeLength[HMAX];   //bits of symbol code, tree is static after init
+
     //for initalizing and other private stuff
     void swap(HuffmanManipulator& huff, Node* node1, Node* node2);
     void swapList(Node* node1, Node* node2);
@@ -83,6 +118,7 @@ public:
 
     void putBit(MessageBuffer& msgbuff, char bit);
     void offsetTransmit(MessageBuffer& msgbuff, int ch);
+    int getCodeLength(int ch) const { return codeLength[ch]; };
 
     int getBit(MessageBuffer& msgbuff);
     int offsetReceive(MessageBuffer& msgbuff);
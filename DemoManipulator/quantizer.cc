@@ -0,0 +1,177 @@
+#include "quantizer.h"
+#include <cmath>
+
+DEMO_NAMESPACE_START
+
+static const char* stateNames[STATE_VEHICLESTATE + 1] = {
+    "base", "entity", "playerstate", "pilotstate", "vehiclestate"
+};
+
+template<class Schema>
+static const Field* getField(int id) {
+    return (id >= 0 && id < Schema::size) ? &Schema::fields[id] : 0;
+}
+
+static const Field* getField(int stateType, int id) {
+    switch (stateType) {
+    case STATE_DELTAENTITY:
+        return getField<EntitySchema>(id);
+    case STATE_PLAYERSTATE:
+        return getField<PlayerSchema>(id);
+    case STATE_PILOTSTATE:
+        return getField<PilotSchema>(id);
+    case STATE_VEHICLESTATE:
+        return getField<VehicleSchema>(id);
+    }
+
+    return 0;
+}
+
+int Quantizer::getFieldsCount(int stateType) {
+    switch (stateType) {
+    case STATE_DELTAENTITY:
+        return EntitySchema::size;
+    case STATE_PLAYERSTATE:
+        return PlayerSchema::size;
+    case STATE_PILOTSTATE:
+        return PilotSchema::size;
+    case STATE_VEHICLESTATE:
+        return VehicleSchema::size;
+    }
+
+    return 0;
+}
+
+const char* Quantizer::getFieldName(int stateType, int id) {
+    const Field* field = getField(stateType, id);
+    return field ? field->_name : "";
+}
+
+void Quantizer::setStep(int stateType, int id, float step) {
+    const Field* field = getField(stateType, id);
+
+    if (!field || field->type != FIELD_FLOAT)
+        throw DemoException("only float fields can be quantized");
+
+    std::vector<Policy>& list = policies[stateType];
+
+    for (int i = 0; i < (int)list.size(); ++i) {
+        if (list[i].id != id)
+            continue;
+
+        if (step > 0.0f)
+            list[i].step = step;
+        else
+            list.erase(list.begin() + i);
+        return;
+    }
+
+    if (step <= 0.0f)
+        return;
+
+    Policy policy;
+    policy.id = id;
+    policy.step = step;
+    policy.rounded = 0;
+    policy.integral = 0;
+    policy.maxError = 0.0f;
+    list.push_back(policy);
+}
+
+int Quantizer::setStep(int stateType, const char* prefix, float step) {
+    int count = 0;
+    size_t length = strlen(prefix);
+
+    for (int id = 0; id < getFieldsCount(stateType); ++id) {
+        const Field* field = getField(stateType, id);
+
+        if (field->type == FIELD_FLOAT && strncmp(field->_name, prefix, length) == 0) {
+            setStep(stateType, id, step);
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+bool Quantizer::isEmpty() const {
+    for (int t = 0; t <= STATE_VEHICLESTATE; ++t)
+        if (!policies[t].empty())
+            return false;
+
+    return true;
+}
+
+void Quantizer::quantize(State* state) {
+    std::vector<Policy>& list = policies[state->getType()];
+    bool zeroed = false;
+
+    for (int i = 0; i < (int)list.size(); ++i) {
+        Policy& policy = list[i];
+
+        if (!state->isAtributeSet(policy.id))
+            continue;
+
+        float value = state->getAtributeFloat(policy.id);
+        float rounded = policy.step * floorf(value / policy.step + 0.5f);
+
+        if (rounded == 0.0f) {
+            rounded = 0.0f; //no negative zero, it isnt null for the coder
+            zeroed = true;
+        }
+
+        if (rounded == value)
+            continue;
+
+        state->setAtribute(policy.id, rounded);
+
+        float error = fabsf(rounded - value);
+        if (error > policy.maxError)
+            policy.maxError = error;
+
+        ++policy.rounded;
+
+        int truncated = (int)rounded;
+        if (truncated == rounded && truncated + FLOAT_INT_BIAS >= 0
+            && truncated + FLOAT_INT_BIAS < (1 << FLOAT_INT_BITS))
+            ++policy.integral;
+    }
+
+    if (zeroed)
+        state->removeNull();
+}
+
+void Quantizer::quantize(Snapshot* snapshot) {
+    if (snapshot->getPlayerstate())
+        quantize(snapshot->getPlayerstate());
+
+    if (snapshot->getVehiclestate())
+        quantize(snapshot->getVehiclestate());
+
+    if (policies[STATE_DELTAENTITY].empty())
+        return;
+
+    std::map<int, EntityState>& entities = snapshot->getEntities();
+    for (std::map<int, EntityState>::iterator it = entities.begin(); it != entities.end(); ++it)
+        if (!it->second.isRemoved())
+            quantize(&it->second);
+}
+
+void Quantizer::report(std::ostream& os) const {
+    for (int t = 0; t <= STATE_VEHICLESTATE; ++t) {
+        for (int i = 0; i < (int)policies[t].size(); ++i) {
+            const Policy& policy = policies[t][i];
+
+            if (!policy.rounded)
+                continue;
+
+            os << stateNames[t] << " " << getFieldName(t, policy.id)
+                << ": step " << policy.step
+                << ", rounded " << policy.rounded
+                << " (" << policy.integral << " integral)"
+                << ", max error " << policy.maxError << std::endl;
+        }
+    }
+}
+
+DEMO_NAMESPACE_END
@@ -0,0 +1,64 @@
+#ifndef QUANTIZER_H
+#define QUANTIZER_H
+
+#include "instruction.h"
+
+DEMO_NAMESPACE_START
+
+/*
+Lossy rounding of float fields of full snapshots, so demo can be encoded
+smaller. Float which is integral and in FLOAT_INT_BITS range takes 13 bits
+instead of 32, and rounded values change less often, so fewer fields are
+sent at all. Step of every field is set separately, fields without step are
+kept as they are.
+
+Rounded values, values which got into 13 bit range and the largest error
+are recorded for every field.
+*/
+class Quantizer
+{
+private:
+    struct Policy {
+        int     id;
+        float   step;
+        int     rounded;    //values changed by rounding
+        int     integral;   //rounded values which take 13 bits now
+        float   maxError;
+    };
+
+    std::vector<Policy> policies[STATE_VEHICLESTATE + 1];
+
+    void quantize(State* state);
+
+public:
+    //number of netfields of state type and their names
+    static int getFieldsCount(int stateType);
+    static const char* getFieldName(int stateType, int id);
+
+    /*
+    Values of the field are rounded to multiples of step, 0 turns rounding
+    of the field off. Only float fields can be rounded.
+    */
+    void setStep(int stateType, int id, float step);
+
+    /*
+    Sets step of all float fields of state type whose name starts with
+    prefix, e.g. "origin[" for all components. Returns number of fields set.
+    */
+    int setStep(int stateType, const char* prefix, float step);
+
+    bool isEmpty() const;
+
+    /*
+    Rounds fields of full snapshot (see Snapshot::makeInit()), fields rounded
+    to 0 are removed.
+    */
+    void quantize(Snapshot* snapshot);
+
+    //one line per field which was rounded: state, field, step, counts and largest error
+    void report(std::ostream& os) const;
+};
+
+DEMO_NAMESPACE_END
+
+#endif
@@ -0,0 +1,125 @@
+#include "snapshotchain.h"
+
+DEMO_NAMESPACE_START
+
+/*
+
+SnapshotHistory Implementation
+
+*/
+
+void SnapshotHistory::clear() {
+    for (snapshotmap::iterator it = snapshots.begin(); it != snapshots.end(); ++it)
+        delete it->second;
+
+    snapshots.clear();
+}
+
+void SnapshotHistory::reset(const Gamestate* gamestate) {
+    clear();
+    baselines = gamestate->getBaseEntities();
+}
+
+Snapshot* SnapshotHistory::find(int seqNumber) {
+    snapshotmap::iterator it = snapshots.find(seqNumber);
+    return (it != snapshots.end()) ? it->second : 0;
+}
+
+Snapshot* SnapshotHistory::add(int seqNumber, Snapshot* snapshot) {
+    Snapshot* base = 0;
+
+    if (snapshot->getDeltanum() != 0) {
+        base = find(seqNumber - snapshot->getDeltanum());
+        if (!base)
+            return 0;
+    }
+
+    Snapshot* full = snapshot->clone();
+
+    //entities which are not in base are delta from baseline
+    std::map<int, EntityState>& entities = full->getEntities();
+    for (std::map<int, EntityState>::iterator it = entities.begin(); it != entities.end(); ++it) {
+        if (base && base->getEntities().count(it->first))
+            continue;
+
+        std::map<int, EntityState>::const_iterator baseline = baselines.find(it->first);
+        if (baseline != baselines.end() && !it->second.isRemoved())
+            it->second.applyOn(&baseline->second);
+    }
+
+    if (base)
+        full->applyOn(base);
+
+    full->makeInit();
+    full->setDeltanum(0);
+
+    delete find(seqNumber);
+    snapshots[seqNumber] = full;
+
+    //forget snapshots which cant be referenced anymore
+    while (!snapshots.empty() && snapshots.begin()->first <= seqNumber - PACKET_BACKUP) {
+        delete snapshots.begin()->second;
+        snapshots.erase(snapshots.begin());
+    }
+
+    return full;
+}
+
+/*
+
+SnapshotEncoder Implementation
+
+*/
+
+SnapshotEncoder::SnapshotEncoder() : last(0), lastSeqNumber(0) {
+}
+
+void SnapshotEncoder::reset(const Gamestate* gamestate) {
+    baselines = gamestate->getBaseEntities();
+    last = 0;
+}
+
+void SnapshotEncoder::encode(int seqNumber, Snapshot* snapshot) {
+    Snapshot* full = (last == &snapshots[0]) ? &snapshots[1] : &snapshots[0];
+    full->assign(snapshot);
+    full->setDeltanum(0);
+
+    bool isDelta = last && seqNumber > lastSeqNumber
+        && seqNumber - lastSeqNumber < PACKET_BACKUP;
+
+    if (isDelta) {
+        snapshot->setDeltanum(0); //entities missing in full snapshot are removed
+        snapshot->delta(last);
+    }
+
+    std::map<int, EntityState>& entities = snapshot->getEntities();
+    for (std::map<int, EntityState>::iterator it = entities.begin(); it != entities.end();) {
+        if (it->second.isRemoved()) {
+            ++it;
+            continue;
+        }
+
+        if (isDelta && last->getEntities().count(it->first)) {
+            //client keeps entities which arent sent
+            if (it->second.noChanged())
+                entities.erase(it++);
+            else
+                ++it;
+            continue;
+        }
+
+        //new entity, client reads it as delta from baseline
+        std::map<int, EntityState>::const_iterator baseline = baselines.find(it->first);
+        if (baseline != baselines.end())
+            it->second.delta(&baseline->second);
+
+        ++it;
+    }
+
+    snapshot->setDeltanum(isDelta ? seqNumber - lastSeqNumber : 0);
+
+    last = full;
+    lastSeqNumber = seqNumber;
+}
+
+DEMO_NAMESPACE_END
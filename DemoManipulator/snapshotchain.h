@@ -0,0 +1,78 @@
+#ifndef SNAPSHOTCHAIN_H
+#define SNAPSHOTCHAIN_H
+
+#include "instruction.h"
+
+DEMO_NAMESPACE_START
+
+/*
+Full snapshots of last PACKET_BACKUP messages of the demo being read, so
+every new snapshot can be resolved by one applyOn() on its delta base.
+Entities which are not in the base are delta from gamestate baselines.
+Messages must be added in order, reset() is called on every gamestate.
+*/
+class SnapshotHistory {
+private:
+    typedef std::map<int, Snapshot*> snapshotmap;
+
+    snapshotmap                         snapshots;  //by sequence number
+    std::map<int, EntityState>          baselines;
+
+    //no copying, history owns its snapshots
+    SnapshotHistory(const SnapshotHistory&);
+    SnapshotHistory& operator=(const SnapshotHistory&);
+
+public:
+    SnapshotHistory() {};
+    ~SnapshotHistory() { clear(); };
+
+    void clear();
+
+    //new gamestate, old snapshots cant be referenced anymore
+    void reset(const Gamestate* gamestate);
+
+    Snapshot* find(int seqNumber);
+
+    /*
+    Returns full copy of the snapshot owned by history (deltanum 0, see
+    Snapshot::makeInit()), 0 when its delta base is not known.
+    */
+    Snapshot* add(int seqNumber, Snapshot* snapshot);
+};
+
+/*
+Encodes full snapshots of output demo, each one is delta from the previous
+encoded snapshot. Entities which are new for the client are delta from
+gamestate baselines (as client reads them), unchanged entities are left out.
+Snapshot is encoded whole when there is no previous one or it is too old
+for the client (PACKET_BACKUP).
+
+Sequence numbers are the ones of output messages, they only have to grow,
+so messages can be dropped. Snapshots must be encoded in order, reset() is
+called on every gamestate.
+*/
+class SnapshotEncoder {
+private:
+    std::map<int, EntityState>  baselines;
+    Snapshot                    snapshots[2];   //last encoded and scratch
+    Snapshot*                   last;
+    int                         lastSeqNumber;
+
+    SnapshotEncoder(const SnapshotEncoder&);
+    SnapshotEncoder& operator=(const SnapshotEncoder&);
+
+public:
+    SnapshotEncoder();
+
+    void reset(const Gamestate* gamestate);
+
+    /*
+    Turns full snapshot (deltanum 0, no removed entities) into delta of the
+    output demo.
+    */
+    void encode(int seqNumber, Snapshot* snapshot);
+};
+
+DEMO_NAMESPACE_END
+
+#endif
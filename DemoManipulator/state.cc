@@ -2,6 +2,138 @@
 
 DEMO_NAMESPACE_START
 
+//out of class definitions of schema tables (needed before C++17)
+constexpr Field EntitySchema::fields[];
+constexpr Field PlayerSchema::fields[];
+constexpr Field PilotSchema::fields[];
+constexpr Field VehicleSchema::fields[];
+
+/*
+Coder of single field, Bits is type of field from schema. ZeroBit tells
+whether field is preceded by bit telling its value isnt zero.
+*/
+template <int Bits, bool ZeroBit>
+struct FieldCoder {
+    static void read(Atribute& value) {
+        if (ZeroBit && !Message::buffer.readBits(SIZE_1BIT))
+            value.iVal = 0;
+        else
+            value.iVal = Message::buffer.readBits(Bits);
+    }
+
+    static void write(const Atribute& value) {
+        if (ZeroBit) {
+            if (value.iVal == 0) {
+                Message::buffer.writeBits(0, SIZE_1BIT);
+                return;
+            }
+            Message::buffer.writeBits(1, SIZE_1BIT);
+        }
+
+        Message::buffer.writeBits(value.iVal, Bits);
+    }
+};
+
+template <bool ZeroBit>
+struct FieldCoder<FIELD_FLOAT, ZeroBit> {
+    static void read(Atribute& value) {
+        if (ZeroBit && !Message::buffer.readBits(SIZE_1BIT)) {
+            value.fVal = 0.0f;
+            return;
+        }
+
+        if (!Message::buffer.readBits(SIZE_1BIT)) {
+            //integral float
+            value.fVal = (float)Message::buffer.readBits(FLOAT_INT_BITS);
+            value.fVal -= FLOAT_INT_BIAS;
+        }
+        else {
+            //full floating point
+            value.iVal = Message::buffer.readBits(SIZE_32BITS);
+        }
+    }
+
+    static void write(const Atribute& value) {
+        if (ZeroBit) {
+            if (value.fVal == 0.0f) {
+                Message::buffer.writeBits(0, SIZE_1BIT);
+                return;
+            }
+            Message::buffer.writeBits(1, SIZE_1BIT);
+        }
+
+        int truncated = (int)value.fVal;
+
+        if ((truncated == value.fVal) && (truncated + FLOAT_INT_BIAS >= 0)
+            && truncated + FLOAT_INT_BIAS < (1 << FLOAT_INT_BITS)) {
+            Message::buffer.writeBits(0, SIZE_1BIT);
+            Message::buffer.writeBits(truncated + FLOAT_INT_BIAS, SIZE_FLOATINT);
+        }
+        else {
+            Message::buffer.writeBits(1, SIZE_1BIT);
+            Message::buffer.writeBits(value.iVal, SIZE_32BITS);
+        }
+    }
+};
+
+/*
+Coder of all fields of a state, unrolled by templates from field I
+to the end of the schema. Every field is preceded by bit telling
+whether it changed.
+*/
+template <class Schema, int I = 0, int N = Schema::size>
+struct FieldsCoder {
+    typedef FieldCoder<Schema::fields[I].type, Schema::zeroBit != 0> Coder;
+    typedef std::map<int, Atribute> AtributeMap;
+
+    //reads fields [I, lastchanged), unselected fields arent stored
+    static void load(int lastchanged, AtributeMap& atributes,
+        int stateType, const Projection* projection) {
+        if (I >= lastchanged)
+            return;
+
+        if (Message::buffer.readBits(SIZE_1BIT)) { //something changed here
+            Atribute value;
+            Coder::read(value);
+
+            //fields come sorted, so they always go to the end
+            if (!projection || projection->isFieldSelected(stateType, I))
+                atributes.insert(atributes.end(), AtributeMap::value_type(I, value));
+        }
+
+        FieldsCoder<Schema, I + 1, N>::load(lastchanged, atributes, stateType, projection);
+    }
+
+    //writes fields up to the last one in the map
+    static void save(AtributeMap::const_iterator it, AtributeMap::const_iterator end) {
+        if (it == end)
+            return;
+
+        if (it->first == I) { //here comes change
+            Message::buffer.writeBits(1, SIZE_1BIT);
+            Coder::write(it->second);
+            ++it;
+        }
+        else {
+            Message::buffer.writeBits(0, SIZE_1BIT);
+        }
+
+        FieldsCoder<Schema, I + 1, N>::save(it, end);
+    }
+};
+
+template <class Schema, int N>
+struct FieldsCoder<Schema, N, N> {
+    typedef std::map<int, Atribute> AtributeMap;
+
+    static void load(int, AtributeMap&, int, const Projection*) {}
+
+    static void save(AtributeMap::const_iterator it, AtributeMap::const_iterator end) {
+        if (it != end)
+            throw DemoException("atribute index out of range");
+    }
+};
+
 float State::getAtributeFloat(int id) const {
     IntAtributeMapCit it = atributes.find(id);
     if (it != atributes.end())
@@ -30,6 +162,13 @@ bool State::isAtributeSet(int id) const {
     return (atributes.find(id) != (atributes.end()));
 }
 
+int State::getBitLength() const {
+    MessageBuffer::Counter counter(Message::buffer);
+    save();
+
+    return counter.getBits();
+}
+
 int State::getAtributesCount() {
     return (int)atributes.size();
 }
@@ -77,57 +216,7 @@ void EntityState::save() const {
     //last changed byte
     Message::buffer.writeBits(((atributes.rbegin())->first) + 1, SIZE_8BITS);
 
-    int nulled = 0;
-    int bufiVal; float buffVal;
-
-    for (std::map<int, Atribute>::const_iterator it = atributes.begin();
-        it != atributes.end(); ++it) {
-        //null previous atributes
-        for (; nulled != it->first; ++nulled) Message::buffer.writeBits(0, SIZE_1BIT);
-
-        //here comes change
-        Message::buffer.writeBits(1, SIZE_1BIT);
-
-        bufiVal = it->second.iVal;
-        buffVal = it->second.fVal;
-
-        if (EntityNetfield[it->first].type == FIELD_FLOAT) {
-            //float number
-
-            if (buffVal == 0.0f) {
-                Message::buffer.writeBits(0, SIZE_1BIT);
-            }
-            else {
-                Message::buffer.writeBits(1, SIZE_1BIT);
-
-                int buffValtrunc = (int)buffVal;
-
-                if ((buffValtrunc == buffVal) && (buffValtrunc + FLOAT_INT_BIAS >= 0)
-                    && buffValtrunc + FLOAT_INT_BIAS < (1 << FLOAT_INT_BITS)) {
-                    Message::buffer.writeBits(0, SIZE_1BIT);
-                    Message::buffer.writeBits(buffValtrunc + FLOAT_INT_BIAS, SIZE_FLOATINT);
-                }
-                else {
-                    Message::buffer.writeBits(1, SIZE_1BIT);
-                    Message::buffer.writeBits(bufiVal, SIZE_32BITS);
-                }
-            }
-
-        }
-        else {
-            //integer
-            if (bufiVal == 0) { //0
-                Message::buffer.writeBits(0, SIZE_1BIT);
-            }
-            else {
-                Message::buffer.writeBits(1, SIZE_1BIT);
-                Message::buffer.writeBits(bufiVal, EntityNetfield[it->first].type);
-            }
-
-        }
-
-        ++nulled;
-    }
+    FieldsCoder<EntitySchema>::save(atributes.begin(), atributes.end());
 }
 
 void EntityState::load() {
@@ -147,42 +236,11 @@ void EntityState::load() {
     //next byte gives upper bound of changed stats
     int lastchanged = Message::buffer.readBits(SIZE_8BITS);
 
-    int size = sizeof(EntityNetfield) / sizeof(Field);
+    if (lastchanged > EntitySchema::size)
+        throw DemoException("entitystate index out of range");
 
     //now we read atributes one by one
-    for (int i = 0; i < lastchanged; i++) {
-        if (i < 0 || i >= size)
-            throw DemoException("entitystate index out of range");
-
-        if (Message::buffer.readBits(SIZE_1BIT)) { //something changed here
-            if (EntityNetfield[i].type == FIELD_FLOAT) {
-                //float number
-                if (!Message::buffer.readBits(SIZE_1BIT)) {
-                    atributes[i].fVal = 0.0f;
-                }
-                else {
-                    if (!Message::buffer.readBits(SIZE_1BIT)) {
-                        //integral float
-                        atributes[i].fVal = (float)Message::buffer.readBits(FLOAT_INT_BITS);
-                        atributes[i].fVal -= FLOAT_INT_BIAS;
-                    }
-                    else {
-                        //full floating point
-                        atributes[i].iVal = Message::buffer.readBits(SIZE_32BITS);
-                    }
-                }
-            }
-            else {
-                //integer
-                if (!Message::buffer.readBits(SIZE_1BIT)) {
-                    atributes[i].iVal = 0;
-                }
-                else {
-                    atributes[i].iVal = Message::buffer.readBits(EntityNetfield[i].type);
-                }
-            }
-        }
-    }
+    FieldsCoder<EntitySchema>::load(lastchanged, atributes, STATE_DELTAENTITY, Message::projection);
 }
 
 void EntityState::report(std::ostream& os) const {
@@ -192,9 +250,9 @@ void EntityState::report(std::ostream& os) const {
     }
     for (std::map<int, Atribute>::const_iterator it = atributes.begin();
         it != atributes.end(); ++it) {
-        os << EntityNetfield[it->first]._name << ": ";
+        os << EntitySchema::fields[it->first]._name << ": ";
 
-        if ((EntityNetfield[it->first].type == FIELD_FLOAT))
+        if ((EntitySchema::fields[it->first].type == FIELD_FLOAT))
             os << it->second.fVal;
         else
             os << it->second.iVal;
@@ -211,7 +269,7 @@ bool EntityState::isChanged() const {
 }
 
 bool EntityState::isAtributeFloat(int id) const {
-    return (EntityNetfield[id].type == FIELD_FLOAT);
+    return (EntitySchema::fields[id].type == FIELD_FLOAT);
 }
 
 bool EntityState::isAtributeInteger(int id) const {
@@ -249,8 +307,8 @@ void EntityState::removeNull() {
 
     for (IntAtributeMapCit it = atributes.begin();
         it != atributes.end(); ++it) {
-        if ((EntityNetfield[it->first].type != FIELD_FLOAT || it->second.fVal != 0.0f)
-            && (EntityNetfield[it->first].type == FIELD_FLOAT || it->second.iVal != 0)) {
+        if ((EntitySchema::fields[it->first].type != FIELD_FLOAT || it->second.fVal != 0.0f)
+            && (EntitySchema::fields[it->first].type == FIELD_FLOAT || it->second.iVal != 0)) {
             tempMap[it->first] = it->second;
         }
     }
@@ -283,43 +341,27 @@ void PlayerState::save() const {
     else
         Message::buffer.writeBits(0, SIZE_8BITS);
 
-    int nulled = 0;
-    int bufiVal; float buffVal;
-
-    for (std::map<int, Atribute>::const_iterator it = atributes.begin();
-        it != atributes.end(); ++it) {
-        //null previous atributes
-        for (; nulled != it->first; ++nulled) Message::buffer.writeBits(0, SIZE_1BIT);
+    FieldsCoder<PlayerSchema>::save(atributes.begin(), atributes.end());
 
-        //here comes change
-        Message::buffer.writeBits(1, SIZE_1BIT);
+    saveStats();
+}
 
-        bufiVal = it->second.iVal;
-        buffVal = it->second.fVal;
+void PlayerState::load() {
+    clear();
 
-        if (PlayerNetfield[it->first].type == FIELD_FLOAT) {
-            //float number
-            int buffValtrunc = (int)buffVal;
+    //first byte gives upper bound of changed stats
+    int lastchanged = Message::buffer.readBits(SIZE_8BITS);
 
-            if ((buffValtrunc == buffVal) && (buffValtrunc + FLOAT_INT_BIAS >= 0)
-                && buffValtrunc + FLOAT_INT_BIAS < (1 << FLOAT_INT_BITS)) {
-                Message::buffer.writeBits(0, SIZE_1BIT);
-                Message::buffer.writeBits(buffValtrunc + FLOAT_INT_BIAS, SIZE_FLOATINT);
-            }
-            else {
-                Message::buffer.writeBits(1, SIZE_1BIT);
-                Message::buffer.writeBits(bufiVal, SIZE_32BITS);
-            }
+    if (lastchanged > PlayerSchema::size)
+        throw DemoException("playerstate index out of range");
 
-        }
-        else {
-            //integer
-            Message::buffer.writeBits(bufiVal, PlayerNetfield[it->first].type);
-        }
+    //now we read atributes one by one
+    FieldsCoder<PlayerSchema>::load(lastchanged, atributes, type, Message::projection);
 
-        ++nulled;
-    }
+    loadStats();
+}
 
+void PlayerState::saveStats() const {
     if (!stats.empty() || !persistant.empty()
         || !ammo.empty() || !powerups.empty()) {
         Message::buffer.writeBits(1, SIZE_1BIT);
@@ -394,72 +436,39 @@ void PlayerState::save() const {
     }
 }
 
-void PlayerState::load() {
-    clear();
+void PlayerState::loadStats() {
+    if (!Message::buffer.readBits(SIZE_1BIT))
+        return;
 
-    //first byte gives upper bound of changed stats
-    int lastchanged = Message::buffer.readBits(SIZE_8BITS);
+    int bits;
 
-    int size = sizeof(PlayerNetfield) / sizeof(Field);
+    if (Message::buffer.readBits(SIZE_1BIT)) {
+        bits = Message::buffer.readBits(SIZE_16BITS);
 
-    //now we read atributes one by one
-    for (int i = 0; i < lastchanged; i++) {
-        if (i < 0 || i >= size)
-            throw DemoException("playerstate index out of range");
-
-        if (Message::buffer.readBits(1)) { //something changed here
-            if (PlayerNetfield[i].type == FIELD_FLOAT) {
-                //float number
-                if (!Message::buffer.readBits(SIZE_1BIT)) {
-                    //integral float
-                    atributes[i].fVal = (float)Message::buffer.readBits(FLOAT_INT_BITS);
-                    atributes[i].fVal -= FLOAT_INT_BIAS;
-                }
-                else {
-                    //full floating point
-                    atributes[i].iVal = Message::buffer.readBits(SIZE_32BITS);
-                }
-            }
-            else {
-                //integer
-                atributes[i].iVal = Message::buffer.readBits(PlayerNetfield[i].type);
-            }
-        }
+        for (int i = 0; i < 16; i++)
+            if (bits & (1 << i)) stats[i] = (i == 4) ? Message::buffer.readBits(SIZE_19BITS)
+                : Message::buffer.readBits(SIZE_16BITS);
     }
 
-    //nacitani statsu
     if (Message::buffer.readBits(SIZE_1BIT)) {
-        int bits;
-
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
+        bits = Message::buffer.readBits(SIZE_16BITS);
 
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) stats[i] = (i == 4) ? Message::buffer.readBits(SIZE_19BITS)
-                    : Message::buffer.readBits(SIZE_16BITS);
-        }
-
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
-
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) persistant[i] = Message::buffer.readBits(SIZE_16BITS);
-        }
-
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
+        for (int i = 0; i < 16; i++)
+            if (bits & (1 << i)) persistant[i] = Message::buffer.readBits(SIZE_16BITS);
+    }
 
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) ammo[i] = Message::buffer.readBits(SIZE_16BITS);
-        }
+    if (Message::buffer.readBits(SIZE_1BIT)) {
+        bits = Message::buffer.readBits(SIZE_16BITS);
 
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
+        for (int i = 0; i < 16; i++)
+            if (bits & (1 << i)) ammo[i] = Message::buffer.readBits(SIZE_16BITS);
+    }
 
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) powerups[i] = Message::buffer.readBits(SIZE_32BITS);
-        }
+    if (Message::buffer.readBits(SIZE_1BIT)) {
+        bits = Message::buffer.readBits(SIZE_16BITS);
 
+        for (int i = 0; i < 16; i++)
+            if (bits & (1 << i)) powerups[i] = Message::buffer.readBits(SIZE_32BITS);
     }
 }
 
@@ -467,9 +476,9 @@ void PlayerState::report(std::ostream& os) const {
     os << "    ";
     for (std::map<int, Atribute>::const_iterator it = atributes.begin();
         it != atributes.end(); ++it) {
-        os << PlayerNetfield[it->first]._name << ": ";
+        os << PlayerSchema::fields[it->first]._name << ": ";
 
-        if ((PlayerNetfield[it->first].type == FIELD_FLOAT))
+        if ((PlayerSchema::fields[it->first].type == FIELD_FLOAT))
             os << it->second.fVal;
         else
             os << it->second.iVal;
@@ -507,7 +516,7 @@ bool PlayerState::isChanged() const {
 }
 
 bool PlayerState::isAtributeFloat(int id) const {
-    return (PlayerNetfield[id].type == FIELD_FLOAT);
+    return (PlayerSchema::fields[id].type == FIELD_FLOAT);
 }
 
 bool PlayerState::isAtributeInteger(int id) const {
@@ -636,8 +645,8 @@ void PlayerState::removeNull() {
 
     for (IntAtributeMapCit it = atributes.begin();
         it != atributes.end(); ++it) {
-        if ((PlayerNetfield[it->first].type != FIELD_FLOAT || it->second.fVal != 0.0f)
-            && (PlayerNetfield[it->first].type == FIELD_FLOAT || it->second.iVal != 0)) {
+        if ((PlayerSchema::fields[it->first].type != FIELD_FLOAT || it->second.fVal != 0.0f)
+            && (PlayerSchema::fields[it->first].type == FIELD_FLOAT || it->second.iVal != 0)) {
             tempMap[it->first] = it->second;
         }
     }
@@ -673,6 +682,24 @@ void PlayerState::removeNull() {
 
 }
 
+int PlayerState::getStat(int id) const {
+    statsarray_cit it = stats.find(id);
+    if (it != stats.end())
+        return it->second;
+
+    return 0;
+}
+
+void PlayerState::assign(const PlayerState* state) {
+    assert(type == state->type);
+
+    atributes = state->atributes;
+    stats = state->stats;
+    persistant = state->persistant;
+    ammo = state->ammo;
+    powerups = state->powerups;
+}
+
 void PlayerState::clear() {
     State::clear();
 
@@ -682,6 +709,10 @@ void PlayerState::clear() {
     powerups.clear();
 }
 
+PilotState* PilotState::clone() {
+    return new PilotState(*this);
+}
+
 void PilotState::save() const {
     //last changed byte
     if (!atributes.empty())
@@ -689,114 +720,9 @@ void PilotState::save() const {
     else
         Message::buffer.writeBits(0, SIZE_8BITS);
 
-    int nulled = 0;
-    int bufiVal; float buffVal;
-
-    for (std::map<int, Atribute>::const_iterator it = atributes.begin();
-        it != atributes.end(); ++it) {
-        //null previous atributes
-        for (; nulled != it->first; ++nulled) Message::buffer.writeBits(0, SIZE_1BIT);
-
-        //here comes change
-        Message::buffer.writeBits(1, SIZE_1BIT);
-
-        bufiVal = it->second.iVal;
-        buffVal = it->second.fVal;
-
-        if (PilotNetfield[it->first].type == FIELD_FLOAT) {
-            //float number
-            int buffValtrunc = (int)buffVal;
-
-            if ((buffValtrunc == buffVal) && (buffValtrunc + FLOAT_INT_BIAS >= 0)
-                && buffValtrunc + FLOAT_INT_BIAS < (1 << FLOAT_INT_BITS)) {
-                Message::buffer.writeBits(0, SIZE_1BIT);
-                Message::buffer.writeBits(buffValtrunc + FLOAT_INT_BIAS, SIZE_FLOATINT);
-            }
-            else {
-                Message::buffer.writeBits(1, SIZE_1BIT);
-                Message::buffer.writeBits(bufiVal, SIZE_32BITS);
-            }
-
-        }
-        else {
-            //integer
-            Message::buffer.writeBits(bufiVal, PilotNetfield[it->first].type);
-        }
-
-        ++nulled;
-    }
-
-    if (!stats.empty() || !persistant.empty()
-        || !ammo.empty() || !powerups.empty()) {
-        Message::buffer.writeBits(1, SIZE_1BIT);
-    }
-    else {
-        Message::buffer.writeBits(0, SIZE_1BIT);
-        return;
-    }
-
-    int bits; statsarray_cit it;
-
-    if (!stats.empty()) {
-        Message::buffer.writeBits(1, SIZE_1BIT);
-
-        bits = 0;
-        for (it = stats.begin(); it != stats.end(); ++it)
-            bits |= 1 << (it->first);
-        Message::buffer.writeBits(bits, SIZE_16BITS);
-        for (it = stats.begin(); it != stats.end(); ++it) {
-            if (it->first == 4) Message::buffer.writeBits(it->second, SIZE_19BITS);
-            else Message::buffer.writeBits(it->second, SIZE_16BITS);
-        }
-    }
-    else {
-        Message::buffer.writeBits(0, SIZE_1BIT);
-    }
-
-    if (!persistant.empty()) {
-        Message::buffer.writeBits(1, SIZE_1BIT);
+    FieldsCoder<PilotSchema>::save(atributes.begin(), atributes.end());
 
-        bits = 0;
-        for (it = persistant.begin(); it != persistant.end(); ++it)
-            bits |= 1 << (it->first);
-        Message::buffer.writeBits(bits, SIZE_16BITS);
-        for (it = persistant.begin(); it != persistant.end(); ++it) {
-            Message::buffer.writeBits(it->second, SIZE_16BITS);
-        }
-    }
-    else {
-        Message::buffer.writeBits(0, SIZE_1BIT);
-    }
-
-    if (!ammo.empty()) {
-        Message::buffer.writeBits(1, SIZE_1BIT);
-
-        bits = 0;
-        for (it = ammo.begin(); it != ammo.end(); ++it)
-            bits |= 1 << (it->first);
-        Message::buffer.writeBits(bits, SIZE_16BITS);
-        for (it = ammo.begin(); it != ammo.end(); ++it) {
-            Message::buffer.writeBits(it->second, SIZE_16BITS);
-        }
-    }
-    else {
-        Message::buffer.writeBits(0, SIZE_1BIT);
-    }
-
-    if (!powerups.empty()) {
-        Message::buffer.writeBits(1, SIZE_1BIT);
-
-        bits = 0;
-        for (it = powerups.begin(); it != powerups.end(); ++it)
-            bits |= 1 << (it->first);
-        Message::buffer.writeBits(bits, SIZE_16BITS);
-        for (it = powerups.begin(); it != powerups.end(); ++it) {
-            Message::buffer.writeBits(it->second, SIZE_32BITS);
-        }
-    }
-    else {
-        Message::buffer.writeBits(0, SIZE_1BIT);
-    }
+    saveStats();
 }
 
 void PilotState::load() {
@@ -805,75 +731,22 @@ void PilotState::load() {
     //first byte gives upper bound of changed stats
     int lastchanged = Message::buffer.readBits(SIZE_8BITS);
 
-    int size = sizeof(PilotNetfield) / sizeof(Field);
+    if (lastchanged > PilotSchema::size)
+        throw DemoException("pilotstate index out of range");
 
     //now we read atributes one by one
-    for (int i = 0; i < lastchanged; i++) {
-        if (i < 0 || i >= size)
-            throw DemoException("pilotstate index out of range");
-
-        if (Message::buffer.readBits(1)) { //something changed here
-            if (PilotNetfield[i].type == FIELD_FLOAT) {
-                //float number
-                if (!Message::buffer.readBits(SIZE_1BIT)) {
-                    //integral float
-                    atributes[i].fVal = (float)Message::buffer.readBits(FLOAT_INT_BITS);
-                    atributes[i].fVal -= FLOAT_INT_BIAS;
-                }
-                else {
-                    //full floating point
-                    atributes[i].iVal = Message::buffer.readBits(SIZE_32BITS);
-                }
-            }
-            else {
-                //integer
-                atributes[i].iVal = Message::buffer.readBits(PilotNetfield[i].type);
-            }
-        }
-    }
-
-    //stats loading
-    if (Message::buffer.readBits(SIZE_1BIT)) {
-        int bits;
-
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
-
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) stats[i] = (i == 4) ? Message::buffer.readBits(SIZE_19BITS)
-                    : Message::buffer.readBits(SIZE_16BITS);
-        }
-
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
-
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) persistant[i] = Message::buffer.readBits(SIZE_16BITS);
-        }
-
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
+    FieldsCoder<PilotSchema>::load(lastchanged, atributes, type, Message::projection);
 
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) ammo[i] = Message::buffer.readBits(SIZE_16BITS);
-        }
-
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
-
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) powerups[i] = Message::buffer.readBits(SIZE_32BITS);
-        }
-    }
+    loadStats();
 }
 
 void PilotState::report(std::ostream& os) const {
     os << "    ";
     for (std::map<int, Atribute>::const_iterator it = atributes.begin();
         it != atributes.end(); ++it) {
-        os << PilotNetfield[it->first]._name << ": ";
+        os << PilotSchema::fields[it->first]._name << ": ";
 
-        if ((PilotNetfield[it->first].type == FIELD_FLOAT))
+        if ((PilotSchema::fields[it->first].type == FIELD_FLOAT))
             os << it->second.fVal;
         else
             os << it->second.iVal;
@@ -898,7 +771,7 @@ void PilotState::report(std::ostream& os) const {
 }
 
 bool PilotState::isAtributeFloat(int id) const {
-    return (PilotNetfield[id].type == FIELD_FLOAT);
+    return (PilotSchema::fields[id].type == FIELD_FLOAT);
 }
 
 bool PilotState::isAtributeInteger(int id) const {
@@ -909,13 +782,17 @@ bool PilotState::hasVehicleSet() const {
     return isAtributeSet(31); //m_iVehicleNum
 }
 
+VehicleState* VehicleState::clone() {
+    return new VehicleState(*this);
+}
+
 void VehicleState::report(std::ostream& os) const {
     os << "    ";
     for (std::map<int, Atribute>::const_iterator it = atributes.begin();
         it != atributes.end(); ++it) {
-        os << VehicleNetfield[it->first]._name << ": ";
+        os << VehicleSchema::fields[it->first]._name << ": ";
 
-        if ((VehicleNetfield[it->first].type == FIELD_FLOAT))
+        if ((VehicleSchema::fields[it->first].type == FIELD_FLOAT))
             os << it->second.fVal;
         else
             os << it->second.iVal;
@@ -946,199 +823,106 @@ void VehicleState::save() const {
     else
         Message::buffer.writeBits(0, SIZE_8BITS);
 
-    int nulled = 0;
-    int bufiVal; float buffVal;
-
-    for (std::map<int, Atribute>::const_iterator it = atributes.begin();
-        it != atributes.end(); ++it) {
-        //null previous atributes
-        for (; nulled != it->first; ++nulled) Message::buffer.writeBits(0, SIZE_1BIT);
+    FieldsCoder<VehicleSchema>::save(atributes.begin(), atributes.end());
 
-        //here comes change
-        Message::buffer.writeBits(1, SIZE_1BIT);
+    saveStats();
+}
 
-        bufiVal = it->second.iVal;
-        buffVal = it->second.fVal;
+void VehicleState::load() {
+    clear();
 
-        if (VehicleNetfield[it->first].type == FIELD_FLOAT) {
-            //float number
-            int buffValtrunc = (int)buffVal;
+    //first byte gives upper bound of changed stats
+    int lastchanged = Message::buffer.readBits(SIZE_8BITS);
 
-            if ((buffValtrunc == buffVal) && (buffValtrunc + FLOAT_INT_BIAS >= 0)
-                && buffValtrunc + FLOAT_INT_BIAS < (1 << FLOAT_INT_BITS)) {
-                Message::buffer.writeBits(0, SIZE_1BIT);
-                Message::buffer.writeBits(buffValtrunc + FLOAT_INT_BIAS, SIZE_FLOATINT);
-            }
-            else {
-                Message::buffer.writeBits(1, SIZE_1BIT);
-                Message::buffer.writeBits(bufiVal, SIZE_32BITS);
-            }
+    if (lastchanged > VehicleSchema::size)
+        throw DemoException("vehiclestate index out of range");
 
-        }
-        else {
-            //integer
-            Message::buffer.writeBits(bufiVal, VehicleNetfield[it->first].type);
-        }
+    //now we read atributes one by one
+    FieldsCoder<VehicleSchema>::load(lastchanged, atributes, type, Message::projection);
 
-        ++nulled;
-    }
+    loadStats();
+}
 
-    if (!stats.empty() || !persistant.empty()
-        || !ammo.empty() || !powerups.empty()) {
-        Message::buffer.writeBits(1, SIZE_1BIT);
-    }
-    else {
-        Message::buffer.writeBits(0, SIZE_1BIT);
-        return;
-    }
+bool VehicleState::isAtributeFloat(int id) const {
+    return (VehicleSchema::fields[id].type == FIELD_FLOAT);
+}
 
-    int bits; statsarray_cit it;
+bool VehicleState::isAtributeInteger(int id) const {
+    return !isAtributeFloat(id);
+}
 
-    if (!stats.empty()) {
-        Message::buffer.writeBits(1, SIZE_1BIT);
+Projection::Projection() : typeFilter(false) {
+    selectRequired();
+    resetEntityTypes();
+}
 
-        bits = 0;
-        for (it = stats.begin(); it != stats.end(); ++it)
-            bits |= 1 << (it->first);
-        Message::buffer.writeBits(bits, SIZE_16BITS);
-        for (it = stats.begin(); it != stats.end(); ++it) {
-            if (it->first == 4) Message::buffer.writeBits(it->second, SIZE_19BITS);
-            else Message::buffer.writeBits(it->second, SIZE_16BITS);
-        }
-    }
-    else {
-        Message::buffer.writeBits(0, SIZE_1BIT);
-    }
+void Projection::selectRequired() {
+    fields[STATE_PLAYERSTATE].set(84); //m_iVehicleNum
+    fields[STATE_PILOTSTATE].set(31); //m_iVehicleNum
 
-    if (!persistant.empty()) {
-        Message::buffer.writeBits(1, SIZE_1BIT);
+    if (typeFilter)
+        fields[STATE_DELTAENTITY].set(8); //eType
+}
 
-        bits = 0;
-        for (it = persistant.begin(); it != persistant.end(); ++it)
-            bits |= 1 << (it->first);
-        Message::buffer.writeBits(bits, SIZE_16BITS);
-        for (it = persistant.begin(); it != persistant.end(); ++it) {
-            Message::buffer.writeBits(it->second, SIZE_16BITS);
-        }
-    }
-    else {
-        Message::buffer.writeBits(0, SIZE_1BIT);
-    }
+void Projection::selectField(int stateType, int id, bool selected) {
+    assert(stateType >= STATE_DELTAENTITY && stateType <= STATE_VEHICLESTATE);
+    assert(id >= 0 && id < 256);
 
+    fields[stateType].set(id, selected);
+    selectRequired();
+}
 
-    if (!ammo.empty()) {
-        Message::buffer.writeBits(1, SIZE_1BIT);
+void Projection::selectAllFields(int stateType, bool selected) {
+    assert(stateType >= STATE_DELTAENTITY && stateType <= STATE_VEHICLESTATE);
 
-        bits = 0;
-        for (it = ammo.begin(); it != ammo.end(); ++it)
-            bits |= 1 << (it->first);
-        Message::buffer.writeBits(bits, SIZE_16BITS);
-        for (it = ammo.begin(); it != ammo.end(); ++it) {
-            Message::buffer.writeBits(it->second, SIZE_16BITS);
-        }
-    }
-    else {
-        Message::buffer.writeBits(0, SIZE_1BIT);
-    }
+    if (selected)
+        fields[stateType].set();
+    else
+        fields[stateType].reset();
+    selectRequired();
+}
 
-    if (!powerups.empty()) {
-        Message::buffer.writeBits(1, SIZE_1BIT);
+void Projection::selectEntityType(int eType, bool selected) {
+    assert(eType >= 0 && eType < 256);
 
-        bits = 0;
-        for (it = powerups.begin(); it != powerups.end(); ++it)
-            bits |= 1 << (it->first);
-        Message::buffer.writeBits(bits, SIZE_16BITS);
-        for (it = powerups.begin(); it != powerups.end(); ++it) {
-            Message::buffer.writeBits(it->second, SIZE_32BITS);
-        }
-    }
-    else {
-        Message::buffer.writeBits(0, SIZE_1BIT);
-    }
+    typeFilter = true;
+    entityTypes.set(eType, selected);
+    selectRequired();
 }
 
-void VehicleState::load() {
-    clear();
+bool Projection::isEntityTypeSelected(int eType) const {
+    if (!typeFilter)
+        return true;
 
-    //first byte gives upper bound of changed stats
-    int lastchanged = Message::buffer.readBits(SIZE_8BITS);
-
-    int size = sizeof(VehicleNetfield) / sizeof(Field);
+    return eType < 0 || eType >= 256 || entityTypes[eType];
+}
 
-    //now we read atributes one by one
-    for (int i = 0; i < lastchanged; i++) {
-        if (i < 0 || i >= size)
-            throw DemoException("vehiclestate index out of range");
-        //throw "vehiclestate index out of range";
-
-        if (Message::buffer.readBits(1)) { //something changed here
-            if (VehicleNetfield[i].type == FIELD_FLOAT) {
-                //float number
-                if (!Message::buffer.readBits(SIZE_1BIT)) {
-                    //integral float
-                    atributes[i].fVal = (float)Message::buffer.readBits(FLOAT_INT_BITS);
-                    atributes[i].fVal -= FLOAT_INT_BIAS;
-                }
-                else {
-                    //full floating point
-                    atributes[i].iVal = Message::buffer.readBits(SIZE_32BITS);
-                }
-            }
-            else {
-                //integer
-                atributes[i].iVal = Message::buffer.readBits(VehicleNetfield[i].type);
-            }
-        }
+void Projection::resetEntityTypes() {
+    for (int i = 0; i < MAX_GENTITIES; ++i) {
+        currentType[i] = -1;
+        baselineType[i] = -1;
     }
+}
 
-    //nacitani statsu
-    if (Message::buffer.readBits(SIZE_1BIT)) {
-        int bits;
-
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
-
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) {
-                    stats[i] = (i == 4) ? Message::buffer.readBits(SIZE_19BITS) : Message::buffer.readBits(SIZE_16BITS);
-                }
-        }
-
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
-
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) {
-                    persistant[i] = Message::buffer.readBits(SIZE_16BITS);
-                }
-        }
-
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
+bool Projection::filterBaseline(int number, const EntityState& entity) {
+    if (entity.isAtributeSet(8)) //eType
+        baselineType[number] = currentType[number] = entity.getAtributeInt(8);
 
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) {
-                    ammo[i] = Message::buffer.readBits(SIZE_16BITS);
-                }
-        }
+    return isEntityTypeSelected(baselineType[number]);
+}
 
-        if (Message::buffer.readBits(SIZE_1BIT)) {
-            bits = Message::buffer.readBits(SIZE_16BITS);
+bool Projection::filterEntity(int number, const EntityState& entity) {
+    int eType = currentType[number];
 
-            for (int i = 0; i < 16; i++)
-                if (bits & (1 << i)) {
-                    powerups[i] = Message::buffer.readBits(SIZE_32BITS);
-                }
-        }
+    if (entity.isRemoved()) {
+        //next time entity comes from baseline again
+        currentType[number] = baselineType[number];
+    }
+    else if (entity.isAtributeSet(8)) { //eType
+        eType = currentType[number] = entity.getAtributeInt(8);
     }
-}
-
-bool VehicleState::isAtributeFloat(int id) const {
-    return (VehicleNetfield[id].type == FIELD_FLOAT);
-}
 
-bool VehicleState::isAtributeInteger(int id) const {
-    return !isAtributeFloat(id);
+    return isEntityTypeSelected(eType);
 }
 
 DEMO_NAMESPACE_END
\ No newline at end of file
@@ -53,6 +53,12 @@ public:
     virtual void save() const = 0;
     virtual	void load() = 0;
 
+    /*
+    Gives exact number of bits written by save(), nothing is written
+    (see MessageBuffer::Counter).
+    */
+    int getBitLength() const;
+
     //get methods
     int getType() const { return type; };
 
@@ -141,6 +147,10 @@ protected:
 
     PlayerState(int id) : State(id) {};
 
+    //stats arrays are encoded the same way for all player state types
+    void saveStats() const;
+    void loadStats();
+
 public:
     PlayerState() : State(STATE_PLAYERSTATE) {};
 
@@ -163,6 +173,12 @@ public:
     void delta(const PlayerState* state, bool isUncompressed);
     void applyOn(PlayerState* state);
 
+    //value of stats array item, 0 when it isnt set (STAT_HEALTH is 0)
+    int getStat(int id) const;
+
+    //copies content of state of the same type, memory of this one is reused
+    void assign(const PlayerState* state);
+
     void clear();
 };
 
@@ -173,6 +189,8 @@ public:
     PilotState() : PlayerState(STATE_PILOTSTATE) {};
     ~PilotState() {};
 
+    PilotState* clone();
+
     void report(std::ostream& os) const;
     void save() const;
     void load();
@@ -189,6 +207,8 @@ public:
     VehicleState() : PlayerState(STATE_VEHICLESTATE) {};
     ~VehicleState() {};
 
+    VehicleState* clone();
+
     void report(std::ostream& os) const;
     void save() const;
     void load();
@@ -197,6 +217,56 @@ public:
     bool isAtributeInteger(int id) const;
 };
 
+/*
+Selects which netfields are stored while decoding (see Demo::setProjection).
+Fields which arent selected are still read from the message, but they are
+never stored in state. Entities can be also filtered by their eType, such
+entities are read but not stored in snapshots nor in gamestate baselines.
+
+Fields needed for decoding itself (m_iVehicleNum) are always stored, eType
+is always stored when entity type filter is used. Stats arrays (stats,
+persistant, ammo, powerups) arent affected.
+
+eType of entities is known only when it was sent, so projection remembers
+last eType of every entity from baselines and previous snapshots. This works
+only when messages are decoded in order, entity of unknown type is stored.
+*/
+class Projection
+{
+private:
+    std::bitset<256> fields[STATE_VEHICLESTATE + 1];
+    std::bitset<256> entityTypes;
+    bool typeFilter;
+
+    //last known eType of entity numbers, -1 when unknown
+    short currentType[MAX_GENTITIES];
+    short baselineType[MAX_GENTITIES];
+
+    void selectRequired();
+
+public:
+    //nothing except required fields is selected and all entity types pass
+    Projection();
+
+    void selectField(int stateType, int id, bool selected = true);
+    void selectAllFields(int stateType, bool selected = true);
+
+    bool isFieldSelected(int stateType, int id) const {
+        return fields[stateType][id];
+    };
+
+    //first call turns on entity type filter, only selected types pass
+    void selectEntityType(int eType, bool selected = true);
+    bool isEntityTypeSelected(int eType) const;
+
+    //called while decoding, forgets remembered eTypes (new gamestate)
+    void resetEntityTypes();
+
+    //called while decoding, tells whether entity should be stored
+    bool filterBaseline(int number, const EntityState& entity);
+    bool filterEntity(int number, const EntityState& entity);
+};
+
 DEMO_NAMESPACE_END
 
 #endif
\ No newline at end of file
@@ -0,0 +1,306 @@
+#include "timeline.h"
+#include "snapshotchain.h"
+#include "entityfilter.h"
+#include <fstream>
+
+DEMO_NAMESPACE_START
+
+//JKA value (bg_public.h), obituary event entity has eType ET_EVENTS + EV_OBITUARY
+enum {
+    EV_OBITUARY = 93
+};
+
+enum {
+    //EntitySchema indices
+    ENTITY_ETYPE = 8,
+    ENTITY_OTHERENTITYNUM2 = 39,    //attacker
+    ENTITY_OTHERENTITYNUM = 59,     //target
+
+    //PlayerSchema indices
+    PLAYER_ORIGIN0 = 2,
+    PLAYER_ORIGIN1 = 1,
+    PLAYER_ORIGIN2 = 5,
+    PLAYER_CLIENTNUM = 43,
+
+    //PilotSchema index, origin has the same indices as in PlayerSchema
+    PILOT_CLIENTNUM = 17,
+
+    STAT_HEALTH = 0
+};
+
+static const char   CACHE_MAGIC[4] = { 'J', 'K', 'T', 'L' };
+static const int    CACHE_VERSION = 2;
+
+static Snapshot* getFirstSnapshot(Message* message) {
+    for (int i = 0; i < message->getInstructionsCount(); ++i)
+        if (message->getInstruction(i)->getType() == INSTR_SNAPSHOT)
+            return message->getInstruction(i)->getSnapshot();
+
+    return 0;
+}
+
+/*
+Gives markers of obituaries in snapshot, which were not in previous snapshot
+already (event entities stay in several snapshots).
+*/
+static int getMarkers(Snapshot* snapshot, Snapshot* previous) {
+    PlayerState* ps = snapshot->getPlayerstate();
+    int clientNum = ps->getAtributeInt(
+        (ps->getType() == STATE_PILOTSTATE) ? PILOT_CLIENTNUM : PLAYER_CLIENTNUM);
+    int markers = 0;
+
+    std::map<int, EntityState>& entities = snapshot->getEntities();
+    for (std::map<int, EntityState>::iterator it = entities.begin(); it != entities.end(); ++it) {
+        if (it->second.getAtributeInt(ENTITY_ETYPE) != ET_EVENTS + EV_OBITUARY)
+            continue;
+
+        if (previous) {
+            std::map<int, EntityState>::iterator old = previous->getEntities().find(it->first);
+
+            if (old != previous->getEntities().end()
+                && old->second.getAtributeInt(ENTITY_ETYPE) == ET_EVENTS + EV_OBITUARY)
+                continue;
+        }
+
+        int target = it->second.getAtributeInt(ENTITY_OTHERENTITYNUM);
+        int attacker = it->second.getAtributeInt(ENTITY_OTHERENTITYNUM2);
+
+        if (target == clientNum)
+            markers |= TIMELINE_DEATH;
+        else if (attacker == clientNum)
+            markers |= TIMELINE_KILL;
+    }
+
+    return markers;
+}
+
+void Timeline::clear() {
+    maps.clear();
+    firstSeconds.clear();
+}
+
+void Timeline::build(Demo* demo, ProgressListener* listener) {
+    clear();
+
+    if (demo->getProjection())
+        throw DemoException("timeline can't be built with projection set");
+
+    int count = demo->getMessageCount();
+    int mapsCount = demo->getMapsCount();
+
+    //message of every second is known from analysis already, seconds before
+    //the first snapshot of the map (demo started late in it) have no entries
+    maps.resize(mapsCount);
+    firstSeconds.resize(mapsCount);
+    for (int m = 0; m < mapsCount; ++m) {
+        int end = (m + 1 < mapsCount) ? demo->getMapId(m + 1) : count;
+
+        firstSeconds[m] = std::max(demo->getMapStartTime(m), 0);
+
+        for (int ms = firstSeconds[m] * 1000;; ms += 1000) {
+            int id = demo->findMessageAtTime(m, ms);
+            if (id >= end)
+                break;
+
+            maps[m].push_back(TimelineEntry());
+            maps[m].back().messageId = id;
+        }
+    }
+
+    //state of the player is read from full snapshots
+    SnapshotHistory history;
+    int previousSeqNumber = -1;
+    int mapId = -1;
+    int entry = 0;
+
+    for (int id = 0; id < count; ++id) {
+        if (listener && (id % 64) == 0 && !listener->progress(id, count))
+            throw DemoException("timeline building cancelled");
+
+        while (mapId + 1 < mapsCount && id >= demo->getMapId(mapId + 1)) {
+            ++mapId;
+            entry = 0;
+        }
+
+        bool wasLoaded = demo->isMessageLoaded(id, DECODE_FULL);
+        Message* message = demo->getMessage(id);
+
+        if (!message)
+            continue;
+
+        Snapshot* snapshot = 0;
+        int seqNumber = message->getSeqNumber();
+
+        for (int i = 0; i < message->getInstructionsCount(); ++i) {
+            Instruction* instr = message->getInstruction(i);
+
+            if (instr->getType() == INSTR_GAMESTATE) {
+                history.reset(instr->getGamestate());
+            }
+        }
+
+        Snapshot* snap = getFirstSnapshot(message);
+        if (snap)
+            snapshot = history.add(seqNumber, snap);
+
+        if (!wasLoaded)
+            demo->unloadMessage(id);
+
+        if (!snapshot || mapId < 0 || maps[mapId].empty())
+            continue;
+
+        std::vector<TimelineEntry>& entries = maps[mapId];
+
+        while (entry + 1 < (int)entries.size() && entries[entry + 1].messageId <= id)
+            ++entry;
+
+        if (entries[entry].messageId <= id)
+            entries[entry].markers |= getMarkers(snapshot, history.find(previousSeqNumber));
+
+        //all seconds starting at this message (more when seconds are without snapshot)
+        for (int e = entry; e >= 0 && entries[e].messageId == id; --e) {
+            PlayerState* ps = snapshot->getPlayerstate();
+
+            entries[e].origin[0] = ps->getAtributeFloat(PLAYER_ORIGIN0);
+            entries[e].origin[1] = ps->getAtributeFloat(PLAYER_ORIGIN1);
+            entries[e].origin[2] = ps->getAtributeFloat(PLAYER_ORIGIN2);
+            entries[e].health = (short)ps->getStat(STAT_HEALTH);
+        }
+
+        previousSeqNumber = seqNumber;
+    }
+}
+
+int Timeline::getEntriesCount(int mapId) const {
+    assert((mapId >= 0) && (mapId < (int)maps.size()));
+    return (int)maps[mapId].size();
+}
+
+int Timeline::getFirstSecond(int mapId) const {
+    assert((mapId >= 0) && (mapId < (int)maps.size()));
+    return firstSeconds[mapId];
+}
+
+const TimelineEntry& Timeline::getEntry(int mapId, int index) const {
+    assert((mapId >= 0) && (mapId < (int)maps.size()));
+    assert((index >= 0) && (index < (int)maps[mapId].size()));
+    return maps[mapId][index];
+}
+
+int Timeline::findEntry(int mapId, int ms) const {
+    assert((mapId >= 0) && (mapId < (int)maps.size()));
+
+    int size = (int)maps[mapId].size();
+    if (!size)
+        return -1;
+
+    int index = ms / 1000 - firstSeconds[mapId];
+    if (index < 0)
+        return 0;
+    if (index >= size)
+        return size - 1;
+
+    return index;
+}
+
+std::string Timeline::getCacheFilename(const std::string& demoFilename) {
+    return demoFilename + ".timeline";
+}
+
+template<class T>
+static void writeValue(std::ostream& os, const T& value) {
+    os.write((const char*)&value, sizeof(T));
+}
+
+template<class T>
+static bool readValue(std::istream& is, T& value) {
+    return (bool)is.read((char*)&value, sizeof(T));
+}
+
+/*
+Cache is written in native byte order, it is only ever read on the machine
+which wrote it.
+
+    magic, version, message count, seq number of last message, maps count
+    for every map: first message id, first second, entries count, entries
+*/
+bool Timeline::save(const char* filename, const Demo* demo) const {
+    std::ofstream os(filename, std::ios::binary);
+    if (!os.is_open())
+        return false;
+
+    int count = demo->getMessageCount();
+
+    os.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    writeValue(os, CACHE_VERSION);
+    writeValue(os, count);
+    writeValue(os, count ? demo->getMessageSeqNumber(count - 1) : 0);
+    writeValue(os, (int)maps.size());
+
+    for (int m = 0; m < (int)maps.size(); ++m) {
+        writeValue(os, demo->getMapId(m));
+        writeValue(os, firstSeconds[m]);
+        writeValue(os, (int)maps[m].size());
+
+        for (int e = 0; e < (int)maps[m].size(); ++e) {
+            const TimelineEntry& entry = maps[m][e];
+
+            writeValue(os, entry.messageId);
+            writeValue(os, entry.origin);
+            writeValue(os, entry.health);
+            writeValue(os, entry.markers);
+        }
+    }
+
+    return !os.fail();
+}
+
+bool Timeline::load(const char* filename, const Demo* demo) {
+    clear();
+
+    std::ifstream is(filename, std::ios::binary);
+    if (!is.is_open())
+        return false;
+
+    char magic[sizeof(CACHE_MAGIC)];
+    int version, count, lastSeqNumber, mapsCount;
+
+    if (!is.read(magic, sizeof(magic)) || memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0
+        || !readValue(is, version) || version != CACHE_VERSION
+        || !readValue(is, count) || count != demo->getMessageCount()
+        || !readValue(is, lastSeqNumber)
+        || lastSeqNumber != (count ? demo->getMessageSeqNumber(count - 1) : 0)
+        || !readValue(is, mapsCount) || mapsCount != demo->getMapsCount())
+        return false;
+
+    std::vector< std::vector<TimelineEntry> > loaded(mapsCount);
+    std::vector<int> loadedSeconds(mapsCount);
+
+    for (int m = 0; m < mapsCount; ++m) {
+        int firstId, size;
+
+        if (!readValue(is, firstId) || firstId != demo->getMapId(m)
+            || !readValue(is, loadedSeconds[m]) || loadedSeconds[m] < 0
+            || !readValue(is, size) || size < 0 || size > count)
+            return false;
+
+        loaded[m].resize(size);
+
+        for (int e = 0; e < size; ++e) {
+            TimelineEntry& entry = loaded[m][e];
+
+            if (!readValue(is, entry.messageId) || !readValue(is, entry.origin)
+                || !readValue(is, entry.health) || !readValue(is, entry.markers))
+                return false;
+
+            if (entry.messageId < 0 || entry.messageId >= count)
+                return false;
+        }
+    }
+
+    maps.swap(loaded);
+    firstSeconds.swap(loadedSeconds);
+    return true;
+}
+
+DEMO_NAMESPACE_END
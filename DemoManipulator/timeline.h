@@ -0,0 +1,99 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "demo.h"
+
+DEMO_NAMESPACE_START
+
+//markers of timeline entry
+enum {
+    TIMELINE_KILL = 1,  //recorded player killed somebody during the second
+    TIMELINE_DEATH = 2  //recorded player died during the second
+};
+
+/*
+State of recorded player at one second of the map.
+*/
+struct TimelineEntry {
+    int     messageId;  //first message at or after the second (same as cutting uses)
+    float   origin[3];
+    short   health;
+    short   markers;    //TIMELINE_KILL, TIMELINE_DEATH
+
+    TimelineEntry() : messageId(0), health(0), markers(0) {
+        origin[0] = origin[1] = origin[2] = 0.0f;
+    };
+};
+
+/*
+Decimated index of the demo, one entry per second of every map from its first
+snapshot (see Demo::getMapStartTime()) to its end. It is small
+enough to be kept in memory and queried without decoding anything, so it can
+back timeline view of the map.
+
+Building needs fully decoded snapshots (entities hold the events), so it is
+separate pass after Demo::analyse(). Kills and deaths come from obituary event
+entities compared with client number of the playerstate, so in follow mode they
+are about the followed player. Built timeline can be saved to cache file and
+loaded again instead of building, cache is checked against the demo.
+*/
+class Timeline
+{
+private:
+    std::vector< std::vector<TimelineEntry> > maps;
+    std::vector<int>                          firstSeconds; //second of the first entry
+
+public:
+    void clear();
+
+    /*
+    Builds timeline of analysed demo, no projection can be set. Demo can be
+    edited, entries hold ids in the edited demo. Messages which were not
+    loaded before are unloaded again.
+
+    listener - optional, gets messages processed out of total, building can be
+           cancelled by it (DemoException is thrown)
+    */
+    void build(Demo* demo, ProgressListener* listener = 0);
+
+    int getMapsCount() const { return (int)maps.size(); };
+
+    /*
+    Gives number of entries (seconds) of the map.
+    */
+    int getEntriesCount(int mapId) const;
+
+    /*
+    Gives second from the map start of the first entry, entry index is at
+    getFirstSecond() + index.
+    */
+    int getFirstSecond(int mapId) const;
+
+    /*
+    Gives entry of the map, see getFirstSecond().
+    */
+    const TimelineEntry& getEntry(int mapId, int index) const;
+
+    /*
+    Gives index of entry for time in ms from the map start, time is clamped to
+    the map length. Returns -1 when map has no entries.
+    */
+    int findEntry(int mapId, int ms) const;
+
+    /*
+    Usual name of cache file for the demo.
+    */
+    static std::string getCacheFilename(const std::string& demoFilename);
+
+    bool save(const char* filename, const Demo* demo) const;
+
+    /*
+    Loads timeline from cache file. Fails when the file is missing, broken or
+    it was not built from this demo (message count and map starts differ).
+    */
+    bool load(const char* filename, const Demo* demo);
+};
+
+DEMO_NAMESPACE_END
+
+#endif
@@ -2,9 +2,16 @@
 #include <fstream>
 #include <string>
 #include <map>
-#include "demo.h"
+#include <algorithm>
+#include "demoreader.h"
+#include "commandtracker.h"
 #include <time.h>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SMOOTHER_SSE
+#endif
+
 using namespace DemoJKA;
 using namespace std;
 
@@ -23,27 +30,12 @@ Snapshot* getFirstSnapshot(Message* message) {
     return 0;
 }
 
-void clearServerCommands(Message* current) {
-    static map<int, int> serverCommands;
-    Instruction* currentInstruction;
-
-    for (int i = 0; i < current->getInstructionsCount(); ++i) {
-        currentInstruction = current->getInstruction(i);
-
-        if (currentInstruction->getType() == INSTR_SERVERCOMMAND) {
-            //get rid of duplicit server commands
-            if (serverCommands.find(currentInstruction->getServerCommand()->getSequenceNumber())
-                != serverCommands.end()) { //found already in received commands
-                current->deleteInstruction(i);
-                --i; //very important, so we can continue in for cycle without problems
-                continue;
-            }
-            else {
-                serverCommands[currentInstruction->getServerCommand()->getSequenceNumber()] = 0;
-            }
-        }
+CommandTracker commandTracker;
 
-    }
+void clearServerCommands(Message* current) {
+    //get rid of duplicit server commands and configstrings overwritten in the same message
+    commandTracker.removeDuplicates(current);
+    CommandTracker::clearSuperseded(current);
 }
 
 static bool removedEntities[1024];
@@ -117,24 +109,158 @@ const int INDEX_ANGLES0 = 4;
 const int INDEX_ANGLES1 = 3;
 const int INDEX_ANGLES2 = 50;
 
-Demo demoToOptimize;
+//entity fields
+const int INDEX_ENT_EFLAGS = 19;
+const int INDEX_ENT_TRTYPE = 23; //pos.trType
+const int TR_INTERPOLATE = 1;
+const int PLAYER_ENTITIES = 32;
+
+/*
+Demo is read in single pass by DemoReader, which finds out vehicle status
+from already read messages, so no analysis pass is needed.
+
+Messages are kept in ring of slots until they are saved. Processing runs
+PACKET_BACKUP messages behind reading, so every delta base is still in the
+ring, and up to windowDepth processed messages can wait in queue for
+interpolation. Slots are allocated once, decoded message is swapped into
+its slot, so memory doesnt grow with the demo.
+*/
+const int DEFAULT_WINDOW_DEPTH = 64;
+
+DemoReader demoReader;
+int windowDepth = DEFAULT_WINDOW_DEPTH;
+vector<Message*> slots;
+vector<int> slotIds; //id of message in slot, -1 for free slot
+int messageCount = 0;
+
 ofstream ouputCopy;
+
+/*
+Saved snapshots are kept in small ring, so saved snapshot can be delta from
+any of last deltaBases saved ones (-b). Every candidate delta is counted
+in bits and the smallest one is written, client keeps last PACKET_BACKUP
+frames, so it reads such demo as usual. It also keeps entities of last
+snapshots in ring of MAX_PARSE_ENTITIES, base is usable only while its
+entities werent overwritten there (see savedParseNumbers).
+*/
+const int MAX_DELTA_BASES = 16;
+
+Snapshot savedSnaps[MAX_DELTA_BASES + 1];
+int savedSeqNumbers[MAX_DELTA_BASES + 1];
+int savedParseNumbers[MAX_DELTA_BASES + 1]; //parsedEntities before saved snapshot
+int parsedEntities = 0; //entities of all written snapshots, as client counts them
+int lastSaved = 0; //index of last saved snapshot in ring
+int savedCount = 0;
+int deltaBases = 1;
+int olderBases = 0;
+
+//last saved snapshot and scratch snapshots, reused for every frame
+Snapshot deltaSnap;
+Snapshot candidateSnap;
 Snapshot* lastSavedSnap = 0;
 int lastSavedSeqNumber = 0;
 int queueStartId = 0;
 int interpolatedSoft = 0;
+int interpolatedEntities = 0;
+bool entitySmoothing = true;
 
-void Interpolate(Snapshot* what, Snapshot* from, Snapshot* to) {
+void initSlots() {
+    int size = windowDepth + PACKET_BACKUP + 1;
+
+    slots.resize(size);
+    slotIds.resize(size);
+
+    for (int i = 0; i < size; ++i) {
+        slots[i] = new Message();
+        slotIds[i] = -1;
+    }
+}
+
+void freeSlots() {
+    for (int i = 0; i < (int)slots.size(); ++i)
+        delete slots[i];
+
+    slots.clear();
+    slotIds.clear();
+}
+
+Message* getMessage(int messageId) {
+    if (messageId < 0)
+        return 0;
+
+    int slot = messageId % (int)slots.size();
+    return (slotIds[slot] == messageId) ? slots[slot] : 0;
+}
+
+void unloadMessage(int messageId) {
+    int slot = messageId % (int)slots.size();
+
+    if (slotIds[slot] == messageId)
+        slotIds[slot] = -1;
+}
+
+/*
+Frames of queue are interpolated in one batch. Values of from and to are
+gathered once, kernel computes all frames of one component at a time and
+results are scattered back to snapshots. Angles are unwrapped while
+gathering, so kernel is plain linear interpolation. Integer fields use the
+same float arithmetic as floats, so results match per frame computation.
+*/
+enum {
+    LERP_ORIGIN0,
+    LERP_ORIGIN1,
+    LERP_ORIGIN2,
+    LERP_VEL0,
+    LERP_VEL1,
+    LERP_VEL2,
+    LERP_ANGLES0,
+    LERP_ANGLES1,
+    LERP_ANGLES2,
+    LERP_BOBCYCLE,
+    LERP_COMMANDTIME,
+    LERP_COUNT
+};
+
+const int LERP_FLOAT_COUNT = LERP_BOBCYCLE; //float components go first
+
+const int lerpIndices[LERP_COUNT] = {
+    INDEX_ORIGIN0, INDEX_ORIGIN1, INDEX_ORIGIN2,
+    INDEX_VEL0, INDEX_VEL1, INDEX_VEL2,
+    INDEX_ANGLES0, INDEX_ANGLES1, INDEX_ANGLES2,
+    INDEX_BOBCYCLE,
+    0 //commandTime
+};
+
+//out[i] = from + factors[i] * delta
+void lerpKernel(const float* factors, int count, float from, float delta, float* out) {
+    int i = 0;
+
+#ifdef SMOOTHER_SSE
+    __m128 vFrom = _mm_set1_ps(from);
+    __m128 vDelta = _mm_set1_ps(delta);
+
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(out + i, _mm_add_ps(vFrom, _mm_mul_ps(_mm_loadu_ps(factors + i), vDelta)));
+#endif
+
+    for (; i < count; ++i)
+        out[i] = from + factors[i] * delta;
+}
+
+//buffers reused by every batch
+vector<Snapshot*> lerpFrames;
+vector<float> lerpFactors;
+vector<float> lerpResults;
+
+void Interpolate(int startId, int endId, Snapshot* from, Snapshot* to) {
+    PlayerState* fromState = from->getPlayerstate();
+    PlayerState* toState = to->getPlayerstate();
 
     //check for teleport
-    if ((from->getPlayerstate()->getAtributeInt(INDEX_EFLAGS) ^ to->getPlayerstate()->getAtributeInt(INDEX_EFLAGS))
+    if ((fromState->getAtributeInt(INDEX_EFLAGS) ^ toState->getAtributeInt(INDEX_EFLAGS))
         & EF_TELEPORT_BIT)
         return;
 
-    if (!what) { //nothing to interpolate
-        return;
-    }
-
     int toTime = to->getServertime();
     int fromTime = from->getServertime();
 
@@ -142,80 +268,74 @@ void Interpolate(Snapshot* what, Snapshot* from, Snapshot* to) {
     if (toTime <= fromTime)
         return;
 
-    float f = (float)(what->getServertime() - fromTime) / (toTime - fromTime);
+    //gather frames
+    lerpFrames.clear();
+    lerpFactors.clear();
 
-    //interpolate bobcycle
-    int fromBobcycle, toBobcycle;
+    for (int id = startId; id < endId; ++id) {
+        Snapshot* what = getFirstSnapshot(getMessage(id));
 
-    fromBobcycle = from->getPlayerstate()->getAtributeInt(INDEX_BOBCYCLE);
-    toBobcycle = to->getPlayerstate()->getAtributeInt(INDEX_BOBCYCLE);
-    if (toBobcycle < fromBobcycle) {
-        toBobcycle += 256; // handle wraparound
+        if (!what) //nothing to interpolate
+            continue;
+
+        lerpFrames.push_back(what);
+        lerpFactors.push_back((float)(what->getServertime() - fromTime) / (toTime - fromTime));
     }
 
-    what->getPlayerstate()->setAtribute(INDEX_BOBCYCLE, (int)(fromBobcycle + f * (toBobcycle - fromBobcycle)));
-
-    //interpolate origin
-    float fromOrigin[3], toOrigin[3];
-
-    fromOrigin[0] = from->getPlayerstate()->getAtributeFloat(INDEX_ORIGIN0);
-    fromOrigin[1] = from->getPlayerstate()->getAtributeFloat(INDEX_ORIGIN1);
-    fromOrigin[2] = from->getPlayerstate()->getAtributeFloat(INDEX_ORIGIN2);
-    toOrigin[0] = to->getPlayerstate()->getAtributeFloat(INDEX_ORIGIN0);
-    toOrigin[1] = to->getPlayerstate()->getAtributeFloat(INDEX_ORIGIN1);
-    toOrigin[2] = to->getPlayerstate()->getAtributeFloat(INDEX_ORIGIN2);
-
-    what->getPlayerstate()->setAtribute(INDEX_ORIGIN0, fromOrigin[0] + f * (toOrigin[0] - fromOrigin[0]));
-    what->getPlayerstate()->setAtribute(INDEX_ORIGIN1, fromOrigin[1] + f * (toOrigin[1] - fromOrigin[1]));
-    what->getPlayerstate()->setAtribute(INDEX_ORIGIN2, fromOrigin[2] + f * (toOrigin[2] - fromOrigin[2]));
-
-    //interpolate velocity
-    float fromVelocity[3], toVelocity[3];
-
-    fromVelocity[0] = from->getPlayerstate()->getAtributeFloat(INDEX_VEL0);
-    fromVelocity[1] = from->getPlayerstate()->getAtributeFloat(INDEX_VEL1);
-    fromVelocity[2] = from->getPlayerstate()->getAtributeFloat(INDEX_VEL2);
-    toVelocity[0] = to->getPlayerstate()->getAtributeFloat(INDEX_VEL0);
-    toVelocity[1] = to->getPlayerstate()->getAtributeFloat(INDEX_VEL1);
-    toVelocity[2] = to->getPlayerstate()->getAtributeFloat(INDEX_VEL2);
-
-    what->getPlayerstate()->setAtribute(INDEX_VEL0, fromVelocity[0] + f * (toVelocity[0] - fromVelocity[0]));
-    what->getPlayerstate()->setAtribute(INDEX_VEL1, fromVelocity[1] + f * (toVelocity[1] - fromVelocity[1]));
-    what->getPlayerstate()->setAtribute(INDEX_VEL2, fromVelocity[2] + f * (toVelocity[2] - fromVelocity[2]));
-
-    //interpolate viewangles
-    float fromAngles[3], toAngles[3];
-
-    fromAngles[0] = from->getPlayerstate()->getAtributeFloat(INDEX_ANGLES0);
-    fromAngles[1] = from->getPlayerstate()->getAtributeFloat(INDEX_ANGLES1);
-    fromAngles[2] = from->getPlayerstate()->getAtributeFloat(INDEX_ANGLES2);
-    toAngles[0] = to->getPlayerstate()->getAtributeFloat(INDEX_ANGLES0);
-    toAngles[1] = to->getPlayerstate()->getAtributeFloat(INDEX_ANGLES1);
-    toAngles[2] = to->getPlayerstate()->getAtributeFloat(INDEX_ANGLES2);
-
-    for (int i = 0; i < 3; ++i) {
-        if (toAngles[i] - fromAngles[i] > 180) {
-            toAngles[i] -= 360;
-        }
-        if (toAngles[i] - fromAngles[i] < -180) {
-            toAngles[i] += 360;
+    int count = (int)lerpFrames.size();
+    if (!count)
+        return;
+
+    //gather from/to values
+    float fromValues[LERP_COUNT], deltas[LERP_COUNT];
+
+    for (int c = 0; c < LERP_FLOAT_COUNT; ++c) {
+        float fromValue = fromState->getAtributeFloat(lerpIndices[c]);
+        float toValue = toState->getAtributeFloat(lerpIndices[c]);
+
+        if (c >= LERP_ANGLES0) {
+            if (toValue - fromValue > 180)
+                toValue -= 360;
+            if (toValue - fromValue < -180)
+                toValue += 360;
         }
+
+        fromValues[c] = fromValue;
+        deltas[c] = toValue - fromValue;
     }
 
-    what->getPlayerstate()->setAtribute(INDEX_ANGLES0, fromAngles[0] + f * (toAngles[0] - fromAngles[0]));
-    what->getPlayerstate()->setAtribute(INDEX_ANGLES1, fromAngles[1] + f * (toAngles[1] - fromAngles[1]));
-    what->getPlayerstate()->setAtribute(INDEX_ANGLES2, fromAngles[2] + f * (toAngles[2] - fromAngles[2]));
+    int fromBobcycle = fromState->getAtributeInt(INDEX_BOBCYCLE);
+    int toBobcycle = toState->getAtributeInt(INDEX_BOBCYCLE);
+    if (toBobcycle < fromBobcycle) {
+        toBobcycle += 256; // handle wraparound
+    }
+
+    fromValues[LERP_BOBCYCLE] = (float)fromBobcycle;
+    deltas[LERP_BOBCYCLE] = (float)(toBobcycle - fromBobcycle);
+
+    int fromCmdTime = fromState->getAtributeInt(0);
+    int toCmdTime = toState->getAtributeInt(0);
+
+    fromValues[LERP_COMMANDTIME] = (float)fromCmdTime;
+    deltas[LERP_COMMANDTIME] = (float)(toCmdTime - fromCmdTime);
 
-    //interpolate commandtime
-    int fromCmdTime, toCmdTime;
-    fromCmdTime = from->getPlayerstate()->getAtributeInt(0);
-    toCmdTime = to->getPlayerstate()->getAtributeInt(0);
+    //compute and scatter
+    lerpResults.resize(count);
 
-    what->getPlayerstate()->setAtribute(0, (int)(fromCmdTime + f * (toCmdTime - fromCmdTime)));
+    for (int c = 0; c < LERP_COUNT; ++c) {
+        lerpKernel(&lerpFactors[0], count, fromValues[c], deltas[c], &lerpResults[0]);
+
+        for (int i = 0; i < count; ++i) {
+            if (c < LERP_FLOAT_COUNT)
+                lerpFrames[i]->getPlayerstate()->setAtribute(lerpIndices[c], lerpResults[i]);
+            else
+                lerpFrames[i]->getPlayerstate()->setAtribute(lerpIndices[c], (int)lerpResults[i]);
+        }
+    }
 }
 
 void uncompressMessage(int messageId) {
-    Snapshot* currentSnap = getFirstSnapshot(demoToOptimize.getMessage(messageId));
+    Snapshot* currentSnap = getFirstSnapshot(getMessage(messageId));
     int seekingSeqNumber;
     int seekingMessageId;
     Message* seekingMessage;
@@ -223,8 +343,8 @@ void uncompressMessage(int messageId) {
     //dereferencing current snapshot so it is not compressed
     if (currentSnap && currentSnap->getDeltanum() != 0) {
         seekingMessageId = messageId - currentSnap->getDeltanum();
-        seekingSeqNumber = demoToOptimize.getMessage(messageId)->getSeqNumber() - currentSnap->getDeltanum();
-        seekingMessage = demoToOptimize.getMessage(seekingMessageId);
+        seekingSeqNumber = getMessage(messageId)->getSeqNumber() - currentSnap->getDeltanum();
+        seekingMessage = getMessage(seekingMessageId);
 
         while (seekingMessage && seekingMessage->getSeqNumber() != seekingSeqNumber) {
             if (seekingSeqNumber < seekingMessage->getSeqNumber())
@@ -232,50 +352,273 @@ void uncompressMessage(int messageId) {
             else
                 ++seekingMessageId;
 
-            seekingMessage = demoToOptimize.getMessage(seekingMessageId);
+            seekingMessage = getMessage(seekingMessageId);
         }
 
+        //delta base isnt in the window (broken demo)
+        if (!seekingMessage)
+            return;
+
         Snapshot* deltaSnap = getFirstSnapshot(seekingMessage);
         currentSnap->applyOn(deltaSnap);
         currentSnap->setDeltanum(0);
     }
 }
 
+/*
+Player entities (0-31) are smoothed the same way as playerstate: when entity
+didnt move since the frame its position first appeared (server didnt get
+new command from that client), the frame is interpolated between that frame
+and the next one where entity moved. Next position is searched in messages
+already read into the ring (up to PACKET_BACKUP ahead), so nothing waits in
+queue. Entity which teleported (EF_TELEPORT_BIT toggled), disappeared or
+isnt interpolated by clients (pos.trType) isnt touched.
+*/
+const int ENTITY_LERP_COUNT = 6;
+
+//pos.trBase[0..2], apos.trBase[0..2]
+const int entityLerpIndices[ENTITY_LERP_COUNT] = { 2, 1, 4, 5, 3, 33 };
+
+struct EntityTrack {
+    bool    valid;
+    int     time;   //server time of frame where position first appeared
+    int     eFlags;
+    float   values[ENTITY_LERP_COUNT];
+};
+
+EntityTrack entityTracks[PLAYER_ENTITIES];
+
+void resetEntityTracks() {
+    for (int i = 0; i < PLAYER_ENTITIES; ++i)
+        entityTracks[i].valid = false;
+}
+
+bool getEntityValues(Snapshot* snap, int number, float* values, int* eFlags) {
+    std::map<int, EntityState>::iterator it = snap->getEntities().find(number);
+
+    if (it == snap->getEntities().end() || it->second.isRemoved()
+        || it->second.getAtributeInt(INDEX_ENT_TRTYPE) != TR_INTERPOLATE)
+        return false;
+
+    for (int i = 0; i < ENTITY_LERP_COUNT; ++i)
+        values[i] = it->second.getAtributeFloat(entityLerpIndices[i]);
+
+    *eFlags = it->second.getAtributeInt(INDEX_ENT_EFLAGS);
+    return true;
+}
+
+bool isGamestateMessage(Message* message) {
+    for (int j = 0; j < message->getInstructionsCount(); ++j)
+        if (message->getInstruction(j)->getType() == INSTR_GAMESTATE)
+            return true;
+
+    return false;
+}
+
+void smoothEntities(int messageId) {
+    Message* message = getMessage(messageId);
+
+    if (isGamestateMessage(message))
+        resetEntityTracks();
+
+    Snapshot* snap = getFirstSnapshot(message);
+    if (!snap)
+        return;
+
+    float values[ENTITY_LERP_COUNT];
+    float nextValues[ENTITY_LERP_COUNT];
+    int eFlags, nextEFlags;
+
+    for (int number = 0; number < PLAYER_ENTITIES; ++number) {
+        EntityTrack& track = entityTracks[number];
+
+        if (!getEntityValues(snap, number, values, &eFlags)) {
+            track.valid = false;
+            continue;
+        }
+
+        if (!track.valid || memcmp(values, track.values, sizeof(values)) != 0
+            || ((eFlags ^ track.eFlags) & EF_TELEPORT_BIT)) {
+            //entity moved, this is new starting point
+            track.valid = true;
+            track.time = snap->getServertime();
+            track.eFlags = eFlags;
+            memcpy(track.values, values, sizeof(values));
+            continue;
+        }
+
+        //entity didnt move, find where it moves next
+        for (int nextId = messageId + 1;; ++nextId) {
+            Message* next = getMessage(nextId);
+            if (!next || isGamestateMessage(next))
+                break;
+
+            Snapshot* nextSnap = getFirstSnapshot(next);
+            if (!nextSnap)
+                continue;
+
+            if (!getEntityValues(nextSnap, number, nextValues, &nextEFlags)
+                || ((nextEFlags ^ track.eFlags) & EF_TELEPORT_BIT))
+                break;
+
+            if (memcmp(nextValues, track.values, sizeof(nextValues)) == 0)
+                continue;
+
+            int fromTime = track.time;
+            int toTime = nextSnap->getServertime();
+
+            if (toTime <= fromTime)
+                break;
+
+            float f = (float)(snap->getServertime() - fromTime) / (toTime - fromTime);
+            EntityState& entity = snap->getEntities()[number];
+
+            for (int i = 0; i < ENTITY_LERP_COUNT; ++i) {
+                float toValue = nextValues[i];
+
+                //unchanged field stays as it is
+                if (toValue == track.values[i])
+                    continue;
+
+                //angles
+                if (i >= 3) {
+                    if (toValue - track.values[i] > 180)
+                        toValue -= 360;
+                    if (toValue - track.values[i] < -180)
+                        toValue += 360;
+                }
+
+                entity.setAtribute(entityLerpIndices[i], track.values[i] + f * (toValue - track.values[i]));
+            }
+
+            ++interpolatedEntities;
+            break;
+        }
+    }
+}
+
 static bool lastMessageWasGamestate = false;
 
+//gives slot of ring after the last saved snapshot, so new one can be stored while older ones are used
+Snapshot* getFreeSavedSnap() {
+    return &savedSnaps[(lastSaved + 1) % (deltaBases + 1)];
+}
+
+//makes snapshot stored by getFreeSavedSnap() the last saved one
+void pushSavedSnap(int seqNumber, bool reset) {
+    lastSaved = (lastSaved + 1) % (deltaBases + 1);
+    savedSeqNumbers[lastSaved] = seqNumber;
+    savedParseNumbers[lastSaved] = parsedEntities;
+    parsedEntities += savedSnaps[lastSaved].getEntitiesCount();
+    savedCount = reset ? 1 : min(savedCount + 1, deltaBases);
+
+    lastSavedSnap = &savedSnaps[lastSaved];
+    lastSavedSeqNumber = seqNumber;
+}
+
+//n-th saved snapshot counting back from the last one
+int getSavedIndex(int n) {
+    return (lastSaved - n + deltaBases + 1) % (deltaBases + 1);
+}
+
+/*
+Finds saved snapshot, which gives smallest delta of full snapshot. Returns
+n for getSavedIndex(), last saved snapshot (0) wins ties. Candidates are
+cleaned without removeNotChanged() state, which makes them only slightly
+bigger than real output.
+*/
+int findDeltaBase(Snapshot* full, int seqNumber, int commandTime) {
+    int best = 0;
+    int bestBits = 0;
+
+    for (int n = 0; n < savedCount; ++n) {
+        int index = getSavedIndex(n);
+
+        //client doesnt keep older frames
+        if (seqNumber - savedSeqNumbers[index] >= PACKET_BACKUP)
+            break;
+
+        //nor entities of frames too far back ("Delta parseEntitiesNum too old")
+        if (parsedEntities - savedParseNumbers[index] > MAX_PARSE_ENTITIES - 128)
+            break;
+
+        candidateSnap.assign(full);
+        candidateSnap.delta(&savedSnaps[index]);
+
+        if (!candidateSnap.getPlayerstate()->isAtributeSet(0))
+            candidateSnap.getPlayerstate()->setAtribute(0, commandTime);
+
+        candidateSnap.removeNotChanged();
+        candidateSnap.setDeltanum(seqNumber - savedSeqNumbers[index]);
+
+        int bits = candidateSnap.getBitLength();
+        if (n == 0 || bits < bestBits) {
+            best = n;
+            bestBits = bits;
+        }
+    }
+
+    return best;
+}
+
+//removeNotChanged() state after snapshot which wasnt delta from last saved one
+void resetRemovedEntities(Snapshot* snap) {
+    for (int i = 0; i < 1024; ++i) {
+        removedEntities[i] = false;
+        notChanged[i] = false;
+    }
+
+    for (std::map<int, EntityState>::iterator it = snap->getEntities().begin(); it != snap->getEntities().end(); ++it)
+        if (it->second.isRemoved())
+            removedEntities[it->first] = true;
+}
+
 void save(int messageId) {
-    Message* message = demoToOptimize.getMessage(messageId);
+    Message* message = getMessage(messageId);
     Snapshot* snapshot = getFirstSnapshot(message);
     int commandTime;
 
     if (snapshot && lastSavedSnap && !lastMessageWasGamestate) {
-        Snapshot* tempLastSavedSnap = lastSavedSnap;
-        lastSavedSnap = snapshot->clone();
+        Snapshot* newSavedSnap = getFreeSavedSnap();
+        newSavedSnap->assign(snapshot);
 
         commandTime = snapshot->getPlayerstate()->getAtributeInt(0);
-        snapshot->delta(tempLastSavedSnap);
+
+        int base = (deltaBases > 1) ? findDeltaBase(newSavedSnap, message->getSeqNumber(), commandTime) : 0;
+        int index = getSavedIndex(base);
+
+        snapshot->delta(&savedSnaps[index]);
 
         if (!snapshot->getPlayerstate()->isAtributeSet(0))
             snapshot->getPlayerstate()->setAtribute(0, commandTime);
 
-        removeNotChanged(snapshot);
-        snapshot->setDeltanum(message->getSeqNumber() - lastSavedSeqNumber);
+        if (base == 0) {
+            removeNotChanged(snapshot);
+        }
+        else {
+            snapshot->removeNotChanged();
+            resetRemovedEntities(snapshot);
+            ++olderBases;
+        }
 
+        snapshot->setDeltanum(message->getSeqNumber() - savedSeqNumbers[index]);
 
-        lastSavedSeqNumber = message->getSeqNumber();
-        delete tempLastSavedSnap;
+        pushSavedSnap(message->getSeqNumber(), false);
     }
     else if (snapshot) {
-        lastSavedSnap = snapshot->clone();
-        lastSavedSeqNumber = message->getSeqNumber();
+        getFreeSavedSnap()->assign(snapshot);
+        pushSavedSnap(message->getSeqNumber(), true);
     }
 
     message->saveMessage(ouputCopy);
-    demoToOptimize.unloadMessage(messageId);
+    unloadMessage(messageId);
 }
 
 void processMessage(int messageId) {
-    Message* message = demoToOptimize.getMessage(messageId);
+    Message* message = getMessage(messageId);
+
+    if (entitySmoothing)
+        smoothEntities(messageId);
 
     Snapshot* processedSnap = getFirstSnapshot(message);
 
@@ -302,17 +645,16 @@ void processMessage(int messageId) {
     }
 
     //here we have message with snapshot which is not first in demo
-    Snapshot* processedSnapClone = processedSnap->clone();
+    deltaSnap.assign(processedSnap);
 
     //we compress it according to last saved message
-    processedSnapClone->delta(lastSavedSnap);
-    processedSnapClone->setDeltanum(message->getSeqNumber() - lastSavedSeqNumber);
+    deltaSnap.delta(lastSavedSnap);
+    deltaSnap.setDeltanum(message->getSeqNumber() - lastSavedSeqNumber);
 
     //does the snapshot differ?
-    if (processedSnapClone->getPlayerstate()->getAtributesCount() == 0) {
+    if (deltaSnap.getPlayerstate()->getAtributesCount() == 0) {
         //this does not differ from last saved message, keep in queue uncompressed
         //this message will be later interpolated
-        delete processedSnapClone;
 
         //if there is not already something in queue, mark this as the start of queue
         if (!queueStartId)
@@ -322,16 +664,13 @@ void processMessage(int messageId) {
     }
 
     //ok snapshot has changes from last saved message, save it
-    delete processedSnapClone;
 
     if (queueStartId) {
         int queueId;
 
         //we need to interpolate and save everything in queue
-        for (queueId = queueStartId; queueId < messageId; ++queueId) {
-            Interpolate(getFirstSnapshot(demoToOptimize.getMessage(queueId)), lastSavedSnap, processedSnap);
-            ++interpolatedSoft;
-        }
+        Interpolate(queueStartId, messageId, lastSavedSnap, processedSnap);
+        interpolatedSoft += messageId - queueStartId;
 
         //everything in queue is interpolatedSoft, lets save it one by one
         for (queueId = queueStartId; queueId < messageId; ++queueId) {
@@ -345,11 +684,46 @@ void processMessage(int messageId) {
     save(messageId);
 }
 
+/*
+Saves queued messages without interpolation, used when queue is longer than
+window or demo ends before next changing snapshot.
+*/
+void flushQueue(int endId) {
+    if (!queueStartId)
+        return;
+
+    for (int queueId = queueStartId; queueId < endId; ++queueId)
+        save(queueId);
+
+    queueStartId = 0;
+}
+
+bool readMessage(int messageId) {
+    if (!demoReader.next())
+        return false;
+
+    int slot = messageId % (int)slots.size();
+
+    //slot is still taken by oldest message of too long queue
+    if (slotIds[slot] != -1)
+        flushQueue(messageId - PACKET_BACKUP);
+
+    slots[slot]->swap(*demoReader.getMessage());
+    slotIds[slot] = messageId;
+
+    return true;
+}
+
 int main(int argc, char** argv) {
 
     if (!CheckArguments(argc)) {
         cout << "Wrong arguments format." << endl;
-        cout << "Usage: Smoother [Input] {Output}" << endl;
+        cout << "Usage: Smoother [Input] {Output} (-w depth) (-p) (-b bases)" << endl;
+        cout << "   -w depth - how many unchanged frames can wait for interpolation (default "
+            << DEFAULT_WINDOW_DEPTH << "), more is smoother and needs more memory" << endl;
+        cout << "   -p - smooth only playerstate, other players are left as they are" << endl;
+        cout << "   -b bases - every snapshot is delta from the one of last bases saved snapshots" << endl;
+        cout << "              which gives smallest output (default 1, max " << MAX_DELTA_BASES << ")" << endl;
         return 1;
     }
 
@@ -360,7 +734,24 @@ int main(int argc, char** argv) {
     for (int i = 2; i < argc; ++i) {
         string para = argv[i];
 
-        outputName = para;
+        if (para == "-p") {
+            entitySmoothing = false;
+        }
+        else if (para == "-w" && i + 1 < argc) {
+            windowDepth = atoi(argv[++i]);
+            if (windowDepth < 1)
+                windowDepth = 1;
+        }
+        else if (para == "-b" && i + 1 < argc) {
+            deltaBases = atoi(argv[++i]);
+            if (deltaBases < 1)
+                deltaBases = 1;
+            if (deltaBases > MAX_DELTA_BASES)
+                deltaBases = MAX_DELTA_BASES;
+        }
+        else {
+            outputName = para;
+        }
     }
 
     if (outputName.empty()) {
@@ -379,7 +770,17 @@ int main(int argc, char** argv) {
 
     ouputCopy.open(outputName, ios::binary);
 
-    if (demoToOptimize.open(demoName.c_str())) {
+    ifstream input(demoName.c_str(), ios::binary);
+    long long inputSize = 0;
+
+    if (input.is_open()) {
+        //size is only for progress
+        input.seekg(0, ios::end);
+        inputSize = (long long)input.tellg();
+        input.seekg(0, ios::beg);
+    }
+
+    if (input.is_open() && demoReader.open(input)) {
         cout << "Demo '" << demoName << "' successfully opened." << endl;
     }
     else {
@@ -387,14 +788,14 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    //analysis
-    demoToOptimize.analyse();
-
     for (int i = 0; i < 1024; ++i) {
         removedEntities[i] = false;
         notChanged[i] = false;
     }
 
+    initSlots();
+    resetEntityTracks();
+
     int newMessageId;
     Message* newMessage;
 
@@ -404,8 +805,8 @@ int main(int argc, char** argv) {
 
     init = clock();
 
-    for (newMessageId = 0; newMessageId < demoToOptimize.getMessageCount(); ++newMessageId) {
-        newMessage = demoToOptimize.getMessage(newMessageId);
+    for (newMessageId = 0; readMessage(newMessageId); ++newMessageId) {
+        newMessage = getMessage(newMessageId);
         clearServerCommands(newMessage); //removing redundant server commands
         uncompressMessage(newMessageId); //making it delta 0
 
@@ -413,16 +814,18 @@ int main(int argc, char** argv) {
             processMessage(newMessageId - 32); //process message
         }
 
-        if ((newMessageId * 20) / (demoToOptimize.getMessageCount() - 1) >= tick) {
-            int percent = (newMessageId * 100) / (demoToOptimize.getMessageCount() - 1);
+        if (inputSize > 0 && (demoReader.getBytesRead() * 20) / inputSize >= tick) {
+            int percent = (int)((demoReader.getBytesRead() * 100) / inputSize);
             cout << "\b\b\b\b" << percent << "%";
             ++tick;
         }
     }
     cout << endl;
 
+    messageCount = newMessageId;
+
     //process rest of messages
-    for (; newMessageId < demoToOptimize.getMessageCount() + 32; ++newMessageId) {
+    for (; newMessageId < messageCount + 32; ++newMessageId) {
         if (newMessageId >= 32) {
             processMessage(newMessageId - 32); //process message
         }
@@ -431,16 +834,9 @@ int main(int argc, char** argv) {
     //last messages can still be waiting in queue so we need to 
     //manually save all stuff in queue now, at least we dont need
     //to do interpolation (since we apparently havent reach next changing snapshot)
-    if (queueStartId) {
-        int queueId;
-
-        //everything in queue is interpolatedSoft, lets save it one by one
-        for (queueId = queueStartId; queueId < demoToOptimize.getMessageCount(); ++queueId) {
-            save(queueId);
-        }
+    flushQueue(messageCount);
 
-        queueStartId = 0;
-    }
+    freeSlots();
 
     final = clock() - init;
 
@@ -448,6 +844,9 @@ int main(int argc, char** argv) {
 
     ouputCopy.close();
     cout << "Interpolated (SOFT) " << interpolatedSoft << " frames." << endl;
+    cout << "Interpolated " << interpolatedEntities << " player entity frames." << endl;
+    if (deltaBases > 1)
+        cout << "Delta from older snapshot in " << olderBases << " frames." << endl;
     cout << "Done in " << s << "s." << endl;
     cout << "'" << outputName << "' saved." << endl;
 